@@ -0,0 +1,326 @@
+/*
+ * analysis_cache.c
+ *
+ * ---------------------------------------------------------------------
+ * DESCRIPTION: A persistent, on-disk cache of search results (best
+ * move, score, bound and depth), keyed on the position hash. The cache
+ * file is memory-mapped, so it can be shared between several engine
+ * processes, and survives from one run to the next.
+ *
+ * The cache is a fixed-size array of entries, indexed by the low bits
+ * of the position hash. Entries are updated without locking: each
+ * entry holds the packed data and (hash XOR data), so an entry that has
+ * been partially written by another process fails the hash check on
+ * reading and is ignored.
+ *
+ * The hashes are only valid for the Zobrist key set they were created
+ * with, so the key signature is stored in the file header and checked
+ * when the file is opened.
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "kestrel.h"
+#include "hashkeys.h"
+#include "tt.h"
+#include "tt_entry.h"
+#include "analysis_cache.h"
+
+
+#define CACHE_MAGIC			0x43454C525453454Bull		// "KESTRELC"
+#define CACHE_VERSION		2		// 2 => scores are relative to the position
+
+struct cache_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t num_entries;			// always a power of 2
+    uint64_t key_signature;			// see get_hash_key_signature()
+    uint8_t reserved[40];
+};
+
+static bool init_cache_file(int fd, uint32_t size_in_mb);
+static bool validate_cache_file(int fd, off_t file_size);
+
+
+static struct cache_header *cache = NULL;
+static struct tt_entry *entries = NULL;
+static size_t cache_size_in_bytes = 0;
+static uint32_t entry_mask = 0;
+
+
+/*
+ * Opens (or creates) the cache file and maps it into memory. An
+ * existing file is used as-is; the size is only used when creating
+ * a new file.
+ *
+ * name: open_analysis_cache
+ * @param	file_name - the cache file
+ * @param	size_in_mb - size of the file to create
+ * @return	true if the cache was opened, false otherwise
+ *
+ */
+bool open_analysis_cache(const char *file_name, uint32_t size_in_mb)
+{
+    close_analysis_cache();
+
+    // the key signature is written to/checked against the file header
+    init_hash_keys();
+
+    int fd = open(file_name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        printf("info string unable to open analysis cache %s\n", file_name);
+        return false;
+    }
+
+    // serialise creation/validation with any other engine processes
+    // opening the same file
+    flock(fd, LOCK_EX);
+
+    struct stat st;
+    bool ok = (fstat(fd, &st) == 0);
+    if (ok && st.st_size == 0) {
+        ok = init_cache_file(fd, size_in_mb);
+        if (ok) {
+            ok = (fstat(fd, &st) == 0);
+        }
+    }
+    if (ok) {
+        ok = validate_cache_file(fd, st.st_size);
+    }
+
+    flock(fd, LOCK_UN);
+
+    if (ok == false) {
+        printf("info string invalid analysis cache %s\n", file_name);
+        close(fd);
+        return false;
+    }
+
+    void *mem = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    // the mapping holds its own reference to the file
+    close(fd);
+
+    if (mem == MAP_FAILED) {
+        printf("info string unable to map analysis cache %s\n", file_name);
+        return false;
+    }
+
+    cache = (struct cache_header *)mem;
+    entries = (struct tt_entry *)(cache + 1);
+    cache_size_in_bytes = (size_t)st.st_size;
+    entry_mask = cache->num_entries - 1;
+
+    return true;
+}
+
+
+void close_analysis_cache(void)
+{
+    if (cache != NULL) {
+        msync(cache, cache_size_in_bytes, MS_ASYNC);
+        munmap(cache, cache_size_in_bytes);
+        cache = NULL;
+        entries = NULL;
+        cache_size_in_bytes = 0;
+        entry_mask = 0;
+    }
+}
+
+bool is_analysis_cache_open(void)
+{
+    return cache != NULL;
+}
+
+
+/*
+ * Adds a search result to the cache. Results from searches shallower
+ * than ANALYSIS_CACHE_MIN_DEPTH are ignored, as are results shallower
+ * than the one already in the slot, so the cache is mostly read.
+ *
+ * As for the transposition table, mate scores need to be made relative
+ * to the position (rather than the root) by the caller.
+ *
+ * name: add_to_analysis_cache
+ * @param	board_hash - the position hash
+ * @param	move - the best move
+ * @param	score - the score
+ * @param	bound - the type of bound the score represents
+ * @param	depth - the search depth
+ * @return
+ *
+ */
+void add_to_analysis_cache(uint64_t board_hash, mv_bitmap move, int32_t score, enum score_bound bound, uint8_t depth)
+{
+    if (cache == NULL || depth < ANALYSIS_CACHE_MIN_DEPTH || move == NO_MOVE) {
+        return;
+    }
+
+    struct tt_entry *entry = &entries[board_hash & entry_mask];
+
+    uint64_t old_data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    if (old_data != 0) {
+        uint8_t old_depth = DATA_DEPTH(old_data);
+        if (old_depth > depth) {
+            return;
+        }
+        if (old_depth == depth && DATA_BOUND(old_data) == BOUND_EXACT && bound != BOUND_EXACT) {
+            return;
+        }
+    }
+
+    // the generation is only meaningful within a process, so it's left as 0
+    uint64_t data = pack_tt_data(move, score, bound, depth, 0);
+    if (data == old_data) {
+        // don't dirty the page if nothing has changed
+        return;
+    }
+
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->key, board_hash ^ data, __ATOMIC_RELAXED);
+}
+
+
+/*
+ * Looks up the position in the cache.
+ *
+ * name: probe_analysis_cache
+ * @param	board_hash - the position hash
+ * @param	info - populated with the cached result
+ * @return	true if the position was found, false otherwise
+ *
+ */
+bool probe_analysis_cache(uint64_t board_hash, struct analysis_cache_entry_info *info)
+{
+    if (cache == NULL) {
+        return false;
+    }
+
+    const struct tt_entry *entry = &entries[board_hash & entry_mask];
+
+    uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    uint64_t key = __atomic_load_n(&entry->key, __ATOMIC_RELAXED);
+
+    if (data == 0 || (key ^ data) != board_hash) {
+        return false;
+    }
+
+    info->move = DATA_MOVE(data);
+    info->score = DATA_SCORE(data);
+    info->bound = DATA_BOUND(data);
+    info->depth = DATA_DEPTH(data);
+    return true;
+}
+
+
+/*
+ * Adds every cached result to the transposition table, so the search
+ * can use the scores as well as the moves.
+ *
+ * name: seed_tt_from_analysis_cache
+ * @param
+ * @return	the number of entries added
+ *
+ */
+uint32_t seed_tt_from_analysis_cache(void)
+{
+    if (cache == NULL) {
+        return 0;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < cache->num_entries; i++) {
+        const struct tt_entry *entry = &entries[i];
+
+        uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+        uint64_t key = __atomic_load_n(&entry->key, __ATOMIC_RELAXED);
+        if (data == 0) {
+            continue;
+        }
+
+        uint64_t board_hash = key ^ data;
+        if ((board_hash & entry_mask) != i) {
+            // partially written entry
+            continue;
+        }
+
+        // the score is already relative to the position, as in the TT
+        add_to_tt(board_hash, DATA_MOVE(data), DATA_SCORE(data), DATA_BOUND(data), DATA_DEPTH(data));
+        count++;
+    }
+    return count;
+}
+
+
+static bool init_cache_file(int fd, uint32_t size_in_mb)
+{
+    size_t size_in_bytes = (size_t)size_in_mb * 1024 * 1024;
+
+    // round the number of entries down to a power of 2
+    uint32_t num_entries = 1;
+    while ((size_t)num_entries * 2 * sizeof(struct tt_entry) + sizeof(struct cache_header) <= size_in_bytes) {
+        num_entries *= 2;
+    }
+
+    struct cache_header header;
+    memset(&header, 0, sizeof(struct cache_header));
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.num_entries = num_entries;
+    header.key_signature = get_hash_key_signature();
+
+    off_t file_size = (off_t)(sizeof(struct cache_header) + (size_t)num_entries * sizeof(struct tt_entry));
+
+    // the extended file is zero-filled, so all entries start out empty
+    if (ftruncate(fd, file_size) != 0) {
+        return false;
+    }
+    return pwrite(fd, &header, sizeof(struct cache_header), 0) == (ssize_t)sizeof(struct cache_header);
+}
+
+
+static bool validate_cache_file(int fd, off_t file_size)
+{
+    struct cache_header header;
+
+    if (pread(fd, &header, sizeof(struct cache_header), 0) != (ssize_t)sizeof(struct cache_header)) {
+        return false;
+    }
+
+    if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION) {
+        return false;
+    }
+    if (header.key_signature != get_hash_key_signature()) {
+        return false;
+    }
+    if (header.num_entries == 0 || (header.num_entries & (header.num_entries - 1)) != 0) {
+        return false;
+    }
+
+    off_t expected_size = (off_t)(sizeof(struct cache_header) + (size_t)header.num_entries * sizeof(struct tt_entry));
+    return file_size == expected_size;
+}
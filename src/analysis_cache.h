@@ -0,0 +1,43 @@
+/*
+ * analysis_cache.h
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "kestrel.h"
+#include "tt.h"
+
+// size used when creating a new cache file
+#define ANALYSIS_CACHE_DEFAULT_MB		16
+
+// only results from searches at least this deep are written to the cache
+#define ANALYSIS_CACHE_MIN_DEPTH		6
+
+
+struct analysis_cache_entry_info {
+    mv_bitmap move;
+    int32_t score;
+    enum score_bound bound;
+    uint8_t depth;
+};
+
+bool open_analysis_cache(const char *file_name, uint32_t size_in_mb);
+void close_analysis_cache(void);
+bool is_analysis_cache_open(void);
+void add_to_analysis_cache(uint64_t board_hash, mv_bitmap move, int32_t score, enum score_bound bound, uint8_t depth);
+bool probe_analysis_cache(uint64_t board_hash, struct analysis_cache_entry_info *info);
+uint32_t seed_tt_from_analysis_cache(void);
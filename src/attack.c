@@ -47,6 +47,10 @@ static void populate_intervening_squares_array(void);
 
 
 
+#define FILE_A_BB	((uint64_t)0x0101010101010101ull)
+#define FILE_H_BB	((uint64_t)0x8080808080808080ull)
+
+
 // a lookup array of bitmasks for squares between the "from" and "to"
 // squares.
 // since there is a commutative property associated with to/from squares
@@ -280,6 +284,164 @@ inline bool is_attacked_diagonally(const struct position *pos,
 
 
 
+/*
+ * Returns a bitboard of all pieces, of both colours, attacking the given
+ * square. Sliding pieces are only included if the squares between them
+ * and the target are empty in 'occupied', so x-ray attackers appear as
+ * the pieces in front of them are removed from the occupancy.
+ *
+ * name: get_attackers_to_square
+ * @param	pos - the position
+ * @param	sq - the target square
+ * @param	occupied - the occupied squares to use for sliding pieces
+ * @return	a bitboard of the attacking pieces
+ *
+ */
+uint64_t get_attackers_to_square(const struct position *pos, enum square sq, uint64_t occupied)
+{
+    const struct bitboards *bb = get_bitboard_struct(pos);
+
+    uint64_t sq_bb = 0;
+    set_bit(&sq_bb, sq);
+
+    // white pawns attack from south-west/south-east of the square, black
+    // pawns from north-west/north-east. Mask off the file wrap-arounds.
+    uint64_t w_pawn_att = ((sq_bb >> 9) & ~FILE_H_BB) | ((sq_bb >> 7) & ~FILE_A_BB);
+    uint64_t b_pawn_att = ((sq_bb << 7) & ~FILE_H_BB) | ((sq_bb << 9) & ~FILE_A_BB);
+
+    uint64_t attackers = (w_pawn_att & get_bitboard_for_piece(bb, W_PAWN))
+                         | (b_pawn_att & get_bitboard_for_piece(bb, B_PAWN));
+
+    uint64_t knights = get_bitboard_for_piece(bb, W_KNIGHT) | get_bitboard_for_piece(bb, B_KNIGHT);
+    attackers |= get_knight_occ_mask(sq) & knights;
+
+    uint64_t kings = get_bitboard_for_king(bb, WHITE) | get_bitboard_for_king(bb, BLACK);
+    attackers |= get_king_occ_mask(sq) & kings;
+
+    uint64_t rq = get_bitboard_combined_rook_queen(bb, WHITE) | get_bitboard_combined_rook_queen(bb, BLACK);
+    rq &= get_rook_occ_mask(sq) & occupied;
+    while (rq != 0) {
+        enum square att_sq = pop_1st_bit(&rq);
+        if ((intervening_squares_lookup[att_sq][sq] & occupied) == 0) {
+            set_bit(&attackers, att_sq);
+        }
+    }
+
+    uint64_t bq = get_bitboard_combined_bishop_queen(bb, WHITE) | get_bitboard_combined_bishop_queen(bb, BLACK);
+    bq &= get_bishop_occ_mask(sq) & occupied;
+    while (bq != 0) {
+        enum square att_sq = pop_1st_bit(&bq);
+        if ((intervening_squares_lookup[att_sq][sq] & occupied) == 0) {
+            set_bit(&attackers, att_sq);
+        }
+    }
+
+    return attackers & occupied;
+}
+
+
+/*
+ * Static Exchange Evaluation. Plays out the sequence of captures on the
+ * 'to' square of the move, each side always capturing with its least
+ * valuable attacker, and either side being able to stop capturing when
+ * it's ahead. Pins are ignored.
+ *
+ * name: see
+ * @param	pos - the position, before the move is made
+ * @param	mv - the move
+ * @return	the expected material gain for the side making the move
+ *
+ */
+int32_t see(const struct position *pos, mv_bitmap mv)
+{
+    const struct bitboards *bb = get_bitboard_struct(pos);
+
+    enum square from_sq = FROMSQ(mv);
+    enum square to_sq = TOSQ(mv);
+    enum piece attacker = get_piece_on_square(pos, from_sq);
+    enum colour side = GET_COLOUR(attacker);
+
+    uint64_t occupied = get_bitboard_all_pieces(bb);
+    clear_bit(&occupied, from_sq);
+
+    int32_t gain[32];
+    gain[0] = 0;
+
+    enum piece captured = get_piece_on_square(pos, to_sq);
+    if (IS_EN_PASS_MOVE(mv)) {
+        // the captured pawn isn't on the 'to' square
+        enum square cap_sq = (side == WHITE) ? (enum square)(to_sq - NORTH) : (enum square)(to_sq + NORTH);
+        clear_bit(&occupied, cap_sq);
+        captured = (side == WHITE) ? B_PAWN : W_PAWN;
+    }
+    if (captured != NO_PIECE) {
+        gain[0] = (int32_t)GET_PIECE_VALUE(captured);
+    }
+
+    enum piece promoted = (enum piece)PROMOTED_PCE(mv);
+    if (promoted != NO_PIECE) {
+        gain[0] += (int32_t)GET_PIECE_VALUE(promoted) - (int32_t)GET_PIECE_VALUE(attacker);
+        attacker = promoted;
+    }
+
+    uint64_t attackers = get_attackers_to_square(pos, to_sq, occupied);
+
+    // least valuable first (knights and bishops are the same value)
+    static const enum piece pce_order[] = {W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING};
+
+    int d = 0;
+    while (d < 31) {
+        side = GET_OPPOSITE_SIDE(side);
+
+        uint64_t side_att = attackers & get_bitboard_for_colour(bb, side);
+        if (side_att == 0) {
+            break;
+        }
+
+        // find the least valuable attacker
+        enum piece lva = NO_PIECE;
+        uint64_t lva_bb = 0;
+        for (size_t i = 0; i < sizeof(pce_order) / sizeof(pce_order[0]); i++) {
+            enum piece pce = (enum piece)(pce_order[i] + side);
+            lva_bb = side_att & get_bitboard_for_piece(bb, pce);
+            if (lva_bb != 0) {
+                lva = pce;
+                break;
+            }
+        }
+        if (lva == NO_PIECE) {
+            break;
+        }
+
+        // only capture with the king if the square is no longer defended
+        if (IS_KING(lva) && (attackers & ~lva_bb & get_bitboard_for_colour(bb, GET_OPPOSITE_SIDE(side))) != 0) {
+            break;
+        }
+
+        d++;
+        gain[d] = (int32_t)GET_PIECE_VALUE(attacker) - gain[d - 1];
+        if (-gain[d - 1] < 0 && gain[d] < 0) {
+            // neither side can gain by continuing
+            break;
+        }
+
+        // remove the attacker, and add any x-ray attackers behind it
+        enum square lva_sq = pop_1st_bit(&lva_bb);
+        clear_bit(&occupied, lva_sq);
+        attackers = get_attackers_to_square(pos, to_sq, occupied);
+        attacker = lva;
+    }
+
+    while (d > 0) {
+        // the side to move at each step can choose to stop capturing
+        gain[d - 1] = -((-gain[d - 1] > gain[d]) ? -gain[d - 1] : gain[d]);
+        d--;
+    }
+    return gain[0];
+}
+
+
+
 // This code returns a bitboard with bits set representing squares between
 // the given 2 squares.
 //
@@ -31,3 +31,5 @@ bool is_attacked_horizontally_or_vertically(const struct position *pos, enum squ
 bool is_attacked_diagonally(const struct position *pos, enum square attacking_sq, enum square target_sq);
 bool is_knight_attacking_square(const struct position *pos, uint64_t sq_bb, enum piece attacking_piece);
 bool is_king_attacking_square(const struct position *pos, uint64_t sq_bb, enum colour col);
+uint64_t get_attackers_to_square(const struct position *pos, enum square sq, uint64_t occupied);
+int32_t see(const struct position *pos, mv_bitmap mv);
@@ -0,0 +1,550 @@
+/*
+ * bench.c
+ *
+ * ---------------------------------------------------------------------
+ * DESCRIPTION : runs a fixed-depth search over a set of positions and
+ * reports the node counts and search speed. Used for comparing the
+ * performance of changes to the search and supporting code.
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "kestrel.h"
+#include "board.h"
+#include "pieces.h"
+#include "fen/fen.h"
+#include "search.h"
+#include "tt.h"
+#include "pawn_table.h"
+#include "eval_cache.h"
+#include "utils.h"
+#include "time_manager.h"
+#include "mate_search.h"
+#include "uci_protocol.h"
+#include "bench.h"
+
+
+static const char *bench_positions[] = {
+    STARTING_FEN,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1\n",
+    "r1b1k2r/ppppnppp/2n2q2/2b5/3NP3/2P1B3/PP3PPP/RN1QKB1R w KQkq - 0 1\n",
+    "1r3rk1/1pnnq1bR/p1pp2B1/P2P1p2/1PP1pP2/2B3P1/5PK1/2Q4R w - - 0 1\n",
+    "8/R7/4kPP1/3ppp2/3B1P2/1K1P1P2/8/8 w - - 0 1\n",
+    "k1K5/p7/P1N5/1P6/4pP2/2p1P3/pp6/r3Q3 w - - 0 1\n",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1\n",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1\n",
+};
+
+#define NUM_BENCH_POSITIONS		(sizeof(bench_positions) / sizeof(bench_positions[0]))
+
+
+// positions with a forced mate, and the number of moves to mate
+static const struct {
+    const char *fen;
+    uint8_t mate_in;
+} mate_positions[] = {
+    { "1r3rk1/1pnnq1bR/p1pp2B1/P2P1p2/1PP1pP2/2B3P1/5PK1/2Q4R w - - 0 1\n", 2 },
+    { "r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 1\n", 2 },
+    { "r1b2k1r/ppp1bppp/8/1B1Q4/5q2/2P5/PPP2PPP/R3R1K1 w - - 1 1\n", 2 },
+    { "2r3k1/p4p2/3Rp2p/1p2P1pK/8/1P4P1/P3Q2P/1q6 b - - 0 1\n", 3 },
+    { "r5rk/5p1p/5R2/4B3/8/8/7P/7K w - - 0 1\n", 3 },
+    { "1k5r/pP3ppp/3p2b1/1BN1n3/1Q2P3/P1B5/KP3P1P/7q w - - 1 1\n", 3 },
+    { "3r4/pR2N3/2pkb3/5p2/8/2B5/qP3PPP/4R1K1 w - - 1 1\n", 3 },
+    { "k1K5/p7/P1N5/1P6/4pP2/2p1P3/pp6/r3Q3 w - - 0 1\n", 4 },
+    { "8/R7/4kPP1/3ppp2/3B1P2/1K1P1P2/8/8 w - - 0 1\n", 5 },
+};
+
+#define NUM_MATE_POSITIONS		(sizeof(mate_positions) / sizeof(mate_positions[0]))
+
+
+// totals over all the bench positions. The search stats are from the
+// main search thread only.
+struct bench_totals {
+    uint64_t nodes;
+    uint64_t time;					// in ms
+    uint64_t qnodes;				// quiescence nodes
+    uint64_t fail_high;				// beta cutoffs
+    uint64_t fail_high_first;		// beta cutoffs on the first move
+};
+
+
+/*
+ * Searches each of the bench positions to the given depth, and returns
+ * the totals for the nodes searched, time taken and search stats.
+ *
+ * name: run_bench_positions
+ * @param	depth - the search depth
+ * @param	tt_size_in_bytes - size of the transposition table
+ * @param	num_threads - the number of search threads
+ * @param	smp_mode - how the threads share the work
+ * @param	verbose - true to print the results for each position
+ * @param	totals - populated with the totals
+ * @return
+ *
+ */
+static void run_bench_positions(uint8_t depth, uint32_t tt_size_in_bytes, uint16_t num_threads,
+                                enum smp_mode smp_mode, bool verbose, struct bench_totals *totals)
+{
+    memset(totals, 0, sizeof(struct bench_totals));
+
+    for(uint32_t i = 0; i < NUM_BENCH_POSITIONS; i++) {
+        struct position *pos = allocate_board();
+        consume_fen_notation(bench_positions[i], pos);
+
+        struct search_info si;
+        init_search_struct(&si);
+        si.depth = depth;
+        si.num_threads = num_threads;
+        si.smp_mode = smp_mode;
+
+        // each position starts with an empty table, so the results
+        // don't depend on the order the positions are searched in
+        create_tt_table(tt_size_in_bytes);
+        clear_tt_table();
+
+        uint64_t start_time = get_monotonic_time_in_millis();
+        search_positions(pos, &si, tt_size_in_bytes);
+        uint64_t elapsed = get_elapsed_time_in_millis(start_time);
+
+        if (verbose) {
+            printf("bench position %2d : nodes %10ju qnodes %10ju time (ms) %8ju\n",
+                   i + 1, (uintmax_t)si.num_nodes, (uintmax_t)si.quiescence_nodes, (uintmax_t)elapsed);
+        }
+
+        totals->nodes += si.num_nodes;
+        totals->time += elapsed;
+        totals->qnodes += si.quiescence_nodes;
+        totals->fail_high += si.fail_high;
+        totals->fail_high_first += si.fail_high_first;
+
+        free_board(pos);
+    }
+}
+
+
+/*
+ * Searches each of the bench positions to the given depth, using a
+ * transposition table of the given size, and prints the node counts
+ * and nodes/sec.
+ *
+ * name: bench
+ * @param	depth - the search depth
+ * @param	tt_size_in_bytes - size of the transposition table
+ * @param	num_threads - the number of search threads
+ * @param	smp_mode - how the threads share the work
+ * @return
+ *
+ */
+void bench(uint8_t depth, uint32_t tt_size_in_bytes, uint16_t num_threads, enum smp_mode smp_mode)
+{
+    struct bench_totals totals;
+
+    reset_pawn_table_stats();
+    reset_eval_cache_stats();
+    clear_eval_cache();
+
+    run_bench_positions(depth, tt_size_in_bytes, num_threads, smp_mode, true, &totals);
+
+    uint64_t nps = 0;
+    if (totals.time > 0) {
+        nps = (totals.nodes * 1000) / totals.time;
+    }
+
+    printf("===========================\n");
+    printf("depth.............%d\n", depth);
+    printf("hash (bytes)......%u\n", tt_size_in_bytes);
+    printf("threads...........%u\n", num_threads);
+    printf("smp mode..........%s\n", smp_mode == SMP_MODE_YBWC ? "ybwc" : "lazy smp");
+    printf("total nodes.......%ju\n", (uintmax_t)totals.nodes);
+    printf("total qnodes......%ju\n", (uintmax_t)totals.qnodes);
+    printf("total time (ms)...%ju\n", (uintmax_t)totals.time);
+    printf("nodes/sec.........%ju\n", (uintmax_t)nps);
+    if (totals.fail_high > 0) {
+        printf("fhf/fh............%.2f%%\n",
+               100.0 * (double)totals.fail_high_first / (double)totals.fail_high);
+    }
+
+    // note: the table stats are for the main search thread only
+    struct pawn_table_stats pawn_stats;
+    get_pawn_table_stats(&pawn_stats);
+    if (pawn_stats.probes > 0) {
+        printf("pawn table hits...%.2f%%\n",
+               100.0 * (double)pawn_stats.hits / (double)pawn_stats.probes);
+    }
+
+    struct eval_cache_stats eval_stats;
+    get_eval_cache_stats(&eval_stats);
+    if (eval_stats.probes > 0) {
+        printf("eval cache hits...%.2f%%\n",
+               100.0 * (double)eval_stats.hits / (double)eval_stats.probes);
+    }
+}
+
+
+/*
+ * Measures how the time to reach a fixed depth scales with the number
+ * of search threads, for each of the SMP modes. The bench positions are
+ * searched with 1, 2, 4, ... threads, up to the given maximum. The
+ * speedup and node counts are relative to the single-threaded search,
+ * so a node ratio above 1 is search overhead.
+ *
+ * name: bench_smp
+ * @param	depth - the search depth
+ * @param	tt_size_in_bytes - size of the transposition table
+ * @param	max_threads - the maximum number of search threads
+ * @return
+ *
+ */
+void bench_smp(uint8_t depth, uint32_t tt_size_in_bytes, uint16_t max_threads)
+{
+    static const struct {
+        enum smp_mode mode;
+        const char *name;
+    } modes[] = {
+        { SMP_MODE_LAZY, "lazy smp" },
+        { SMP_MODE_YBWC, "ybwc" },
+    };
+
+    for(uint32_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        uint64_t base_time = 0;
+        uint64_t base_nodes = 0;
+
+        printf("%s\n", modes[m].name);
+        printf("threads    time (ms)   speedup        nodes  node ratio    nodes/sec\n");
+
+        for(uint16_t threads = 1; threads <= max_threads; threads = (uint16_t)(threads * 2)) {
+            struct bench_totals totals;
+
+            clear_eval_cache();
+            run_bench_positions(depth, tt_size_in_bytes, threads, modes[m].mode, false, &totals);
+            uint64_t total_nodes = totals.nodes;
+            uint64_t total_time = totals.time;
+
+            if (threads == 1) {
+                base_time = total_time;
+                base_nodes = total_nodes;
+            }
+
+            double speedup = 0.0;
+            uint64_t nps = 0;
+            if (total_time > 0) {
+                speedup = (double)base_time / (double)total_time;
+                nps = (total_nodes * 1000) / total_time;
+            }
+            double node_ratio = 0.0;
+            if (base_nodes > 0) {
+                node_ratio = (double)total_nodes / (double)base_nodes;
+            }
+
+            printf("%7u %12ju %9.2f %12ju %11.2f %12ju\n", threads, (uintmax_t)total_time,
+                   speedup, (uintmax_t)total_nodes, node_ratio, (uintmax_t)nps);
+        }
+    }
+}
+
+
+/*
+ * Measures the time taken to allocate and clear the transposition
+ * table, for a range of table sizes. The table is filled before being
+ * cleared, so every page is in use.
+ *
+ * name: bench_tt_clear
+ * @param
+ * @return
+ *
+ */
+void bench_tt_clear(void)
+{
+    printf("  size (MB)   create (ms)    fill (ms)   clear (ms)\n");
+
+    for(uint32_t mb = 16; mb <= BENCH_MAX_TT_SIZE_MB; mb *= 2) {
+        uint32_t size_in_bytes = mb * 1024 * 1024;
+
+        dispose_tt_table();
+
+        uint64_t start_time = get_monotonic_time_in_millis();
+        create_tt_table(size_in_bytes);
+        uint64_t create_time = get_elapsed_time_in_millis(start_time);
+
+        // touch every entry
+        start_time = get_monotonic_time_in_millis();
+        for(uint64_t hash = 0; hash < size_in_bytes / 16; hash++) {
+            add_to_tt(hash, (mv_bitmap)(hash + 1), 0, BOUND_EXACT, 1);
+        }
+        uint64_t fill_time = get_elapsed_time_in_millis(start_time);
+
+        start_time = get_monotonic_time_in_millis();
+        clear_tt_table();
+        uint64_t clear_time = get_elapsed_time_in_millis(start_time);
+
+        printf("%11u %13ju %12ju %12ju\n", mb, (uintmax_t)create_time,
+               (uintmax_t)fill_time, (uintmax_t)clear_time);
+    }
+
+    dispose_tt_table();
+}
+
+
+/*
+ * Compares the proof-number mate solver with alpha-beta, on a set of
+ * positions with a forced mate. Each position is solved with
+ * search_mate(), then searched by alpha-beta to the depth of the mate
+ * (2N-1 plies). Both start with empty tables.
+ *
+ * name: bench_mate
+ * @param	tt_size_in_bytes - size of the transposition table, and the
+ * 			mate search table
+ * @return
+ *
+ */
+void bench_mate(uint32_t tt_size_in_bytes)
+{
+    uint64_t pn_total_nodes = 0, pn_total_time = 0;
+    uint64_t ab_total_nodes = 0, ab_total_time = 0;
+    uint32_t pn_solved = 0, ab_solved = 0;
+
+    printf("  pos  mate    pn nodes  pn time (ms)  found    ab nodes  ab time (ms)  found\n");
+
+    for(uint32_t i = 0; i < NUM_MATE_POSITIONS; i++) {
+        uint8_t mate_plies = (uint8_t)(2 * mate_positions[i].mate_in - 1);
+
+        struct position *pos = allocate_board();
+        consume_fen_notation(mate_positions[i].fen, pos);
+
+        struct search_info si;
+        init_search_struct(&si);
+        struct mate_search_result result;
+
+        uint64_t start_time = get_monotonic_time_in_millis();
+        bool pn_found = search_mate(pos, &si, mate_positions[i].mate_in, tt_size_in_bytes, &result);
+        uint64_t pn_time = get_elapsed_time_in_millis(start_time);
+        uint64_t pn_nodes = si.num_nodes;
+
+        init_search_struct(&si);
+        si.depth = mate_plies;
+        create_tt_table(tt_size_in_bytes);
+        clear_tt_table();
+        clear_eval_cache();
+
+        start_time = get_monotonic_time_in_millis();
+        search_positions(pos, &si, tt_size_in_bytes);
+        uint64_t ab_time = get_elapsed_time_in_millis(start_time);
+        bool ab_found = (si.line_scores[0] >= MATE - mate_plies);
+
+        printf("%5u %5u %11ju %13ju %6s %11ju %13ju %6s\n", i + 1, mate_positions[i].mate_in,
+               (uintmax_t)pn_nodes, (uintmax_t)pn_time, pn_found ? "yes" : "no",
+               (uintmax_t)si.num_nodes, (uintmax_t)ab_time, ab_found ? "yes" : "no");
+
+        pn_total_nodes += pn_nodes;
+        pn_total_time += pn_time;
+        pn_solved += pn_found;
+        ab_total_nodes += si.num_nodes;
+        ab_total_time += ab_time;
+        ab_solved += ab_found;
+
+        free_board(pos);
+    }
+
+    printf("===========================\n");
+    printf("positions.........%zu\n", NUM_MATE_POSITIONS);
+    printf("pn solved.........%u\n", pn_solved);
+    printf("pn nodes..........%ju\n", (uintmax_t)pn_total_nodes);
+    printf("pn time (ms)......%ju\n", (uintmax_t)pn_total_time);
+    printf("ab solved.........%u\n", ab_solved);
+    printf("ab nodes..........%ju\n", (uintmax_t)ab_total_nodes);
+    printf("ab time (ms)......%ju\n", (uintmax_t)ab_total_time);
+}
+
+
+static int compare_overruns(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+
+/*
+ * Measures how far fixed-time searches run past their time limit. The
+ * bench positions are searched in turn, as for "go movetime", and the
+ * overrun is the time search_positions() takes beyond the maximum time
+ * it was given (the move time, less the move overhead). Only searches
+ * stopped at the time limit are counted, not those that decided against
+ * starting another iteration. The transposition table isn't cleared
+ * between searches, as in a game.
+ *
+ * name: bench_movetime
+ * @param	move_time_ms - the move time for each search
+ * @param	num_searches - the number of searches
+ * @param	tt_size_in_bytes - size of the transposition table
+ * @param	num_threads - the number of search threads
+ * @return
+ *
+ */
+void bench_movetime(uint32_t move_time_ms, uint32_t num_searches, uint32_t tt_size_in_bytes, uint16_t num_threads)
+{
+    int64_t *overruns = malloc(num_searches * sizeof(int64_t));
+    if (overruns == NULL) {
+        return;
+    }
+
+    struct time_control tc = {
+        .time_left = -1,
+        .increment = 0,
+        .moves_to_go = 0,
+        .move_time = (int32_t)move_time_ms
+    };
+    struct time_limits limits;
+    calc_time_limits(&tc, &limits);
+
+    create_tt_table(tt_size_in_bytes);
+    clear_tt_table();
+    clear_eval_cache();
+
+    uint32_t num_stopped = 0;
+    int64_t total = 0;
+    uint32_t over_move_time = 0;
+
+    for(uint32_t i = 0; i < num_searches; i++) {
+        struct position *pos = allocate_board();
+        consume_fen_notation(bench_positions[i % NUM_BENCH_POSITIONS], pos);
+
+        struct search_info si;
+        init_search_struct(&si);
+        si.depth = MAX_SEARCH_DEPTH;
+        si.num_threads = num_threads;
+        si.time_limits = limits;
+        si.search_time_set = true;
+
+        uint64_t start_time = get_monotonic_time_in_micros();
+        search_positions(pos, &si, tt_size_in_bytes);
+        uint64_t elapsed = get_monotonic_time_in_micros() - start_time;
+
+        if (elapsed > (uint64_t)move_time_ms * 1000) {
+            over_move_time++;
+        }
+        if (si.search_stopped) {
+            overruns[num_stopped] = (int64_t)elapsed - (int64_t)limits.maximum_ms * 1000;
+            total += overruns[num_stopped];
+            num_stopped++;
+        }
+
+        free_board(pos);
+    }
+
+    printf("===========================\n");
+    printf("move time (ms)....%u\n", move_time_ms);
+    printf("time limit (ms)...%u\n", limits.maximum_ms);
+    printf("threads...........%u\n", num_threads);
+    printf("searches..........%u\n", num_searches);
+    printf("stopped at limit..%u\n", num_stopped);
+    if (num_stopped > 0) {
+        qsort(overruns, num_stopped, sizeof(int64_t), compare_overruns);
+        printf("overrun (ms)......avg %.3f median %.3f p99 %.3f max %.3f\n",
+               (double)total / num_stopped / 1000.0,
+               (double)overruns[num_stopped / 2] / 1000.0,
+               (double)overruns[num_stopped * 99 / 100] / 1000.0,
+               (double)overruns[num_stopped - 1] / 1000.0);
+    }
+    printf("over move time....%u\n", over_move_time);
+
+    free(overruns);
+}
+
+
+// parses the "bench" command, which is of the format
+// 		bench [depth <x>] [hash <MB>] [threads <x>] [ybwc]
+// or
+// 		bench smp [depth <x>] [hash <MB>] [threads <max>]
+// or
+// 		bench tt
+// or
+// 		bench movetime <ms> [count <x>] [hash <MB>] [threads <x>]
+// or
+// 		bench mate [hash <MB>]
+void uci_parse_bench(char *line)
+{
+    uint8_t depth = BENCH_DEFAULT_DEPTH;
+    uint32_t tt_size = BENCH_DEFAULT_TT_SIZE;
+    bool smp = false;
+    uint16_t threads = 1;
+    enum smp_mode smp_mode = SMP_MODE_LAZY;
+    char *ptr = NULL;
+
+    if (strstr(line, "bench tt")) {
+        bench_tt_clear();
+        return;
+    }
+
+    if (strstr(line, "bench smp")) {
+        smp = true;
+        threads = BENCH_SMP_MAX_THREADS;
+    }
+
+    if ((ptr = strstr(line, "depth"))) {
+        depth = (uint8_t)atoi(ptr + 6);		// skip over "depth "
+    }
+    if ((ptr = strstr(line, "hash"))) {
+        int32_t mb = atoi(ptr + 5);		// skip over "hash "
+        if (mb < UCI_HASH_MIN_MB) {
+            mb = UCI_HASH_MIN_MB;
+        } else if (mb > UCI_HASH_MAX_MB) {
+            mb = UCI_HASH_MAX_MB;
+        }
+        tt_size = (uint32_t)mb * 1024 * 1024;
+    }
+    if ((ptr = strstr(line, "threads"))) {
+        int32_t n = atoi(ptr + 8);		// skip over "threads "
+        if (n < 1) {
+            n = 1;
+        } else if (n > MAX_SEARCH_THREADS) {
+            n = MAX_SEARCH_THREADS;
+        }
+        threads = (uint16_t)n;
+    }
+
+    if (strstr(line, "ybwc")) {
+        smp_mode = SMP_MODE_YBWC;
+    }
+
+    if (strstr(line, "bench mate")) {
+        bench_mate(tt_size);
+        return;
+    }
+
+    if ((ptr = strstr(line, "bench movetime"))) {
+        uint32_t move_time = (uint32_t)atoi(ptr + 15);	// skip over "bench movetime "
+        uint32_t count = BENCH_MOVETIME_DEFAULT_COUNT;
+        if ((ptr = strstr(line, "count"))) {
+            count = (uint32_t)atoi(ptr + 6);	// skip over "count "
+        }
+        if (count > 0) {
+            bench_movetime(move_time, count, tt_size, threads);
+        }
+        return;
+    }
+
+    if (smp) {
+        bench_smp(depth, tt_size, threads);
+    } else {
+        bench(depth, tt_size, threads, smp_mode);
+    }
+}
@@ -0,0 +1,34 @@
+/*
+ * bench.h
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "kestrel.h"
+#include "search.h"
+
+#define BENCH_DEFAULT_DEPTH		5
+#define BENCH_DEFAULT_TT_SIZE	(64 * 1024 * 1024)
+#define BENCH_MAX_TT_SIZE_MB	2048
+#define BENCH_SMP_MAX_THREADS	64
+#define BENCH_MOVETIME_DEFAULT_COUNT	1000
+
+void bench(uint8_t depth, uint32_t tt_size_in_bytes, uint16_t num_threads, enum smp_mode smp_mode);
+void bench_smp(uint8_t depth, uint32_t tt_size_in_bytes, uint16_t max_threads);
+void bench_tt_clear(void);
+void bench_movetime(uint32_t move_time_ms, uint32_t num_searches, uint32_t tt_size_in_bytes, uint16_t num_threads);
+void bench_mate(uint32_t tt_size_in_bytes);
+void uci_parse_bench(char *line);
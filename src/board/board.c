@@ -39,6 +39,8 @@
 #include "move_gen_utils.h"
 #include "board_utils.h"
 #include "tt.h"
+#include "eval_cache.h"
+#include "pawn_table.h"
 #include "hashkeys.h"
 #include "pieces.h"
 
@@ -104,6 +106,9 @@ struct position {
     // a hash of the current board
     uint64_t board_hash;
 
+    // a hash of just the pawns on the board
+    uint64_t pawn_hash;
+
     // the square where en passent is active
     enum square en_passant;
 
@@ -125,7 +130,6 @@ struct position {
 
 
     // move ordering
-    uint32_t search_history[NUM_PIECES][NUM_SQUARES];
     mv_bitmap search_killers[NUM_KILLER_MOVES][MAX_SEARCH_DEPTH];
 
 };
@@ -143,10 +147,40 @@ struct position* allocate_board(void){
 	return pos;
 }
 
+/*
+ * Allocates a copy of the given board. Unlike allocate_board(), the shared
+ * lookup tables aren't re-initialised, so this is safe to call while
+ * other threads are searching.
+ *
+ * name: duplicate_board
+ * @param	pos - the board to copy
+ * @return	the copy, to be released with free_board()
+ *
+ */
+struct position* duplicate_board(const struct position *pos){
+	struct position *copy = (struct position *)malloc(sizeof(struct position));
+	clone_board(pos, copy);
+	return copy;
+}
+
 void free_board(struct position *pos){
 	free(pos);
 }
 
+/*
+ * Empties the board, ready for a new position to be set up (eg, from
+ * a FEN string, which only adds pieces).
+ *
+ * name: reset_board
+ * @param	pos - the board to reset
+ * @return
+ *
+ */
+void reset_board(struct position *pos){
+	memset(pos, 0, sizeof(struct position));
+	get_clean_board(pos);
+}
+
 
 
 
@@ -203,16 +237,6 @@ static void get_clean_board(struct position *pos)
 }
 
 
-void init_search_history(struct position *pos){
-
-    for(int i = 0; i < NUM_PIECES; i++) {
-        for(int j = 0; j < NUM_SQUARES; j++) {
-            pos->search_history[i][j] = NO_MOVE;
-        }
-    }
-}
-
-
 void init_search_killers(struct position *pos){
 
     for(int i = 0; i < NUM_KILLER_MOVES; i++) {
@@ -229,33 +253,6 @@ void init_search_killers(struct position *pos){
 
 
 
-// returns the count.
-uint8_t populate_pv_line(struct position *pos, uint8_t depth)
-{
-
-    mv_bitmap mv = probe_tt(pos->board_hash);
-
-    uint8_t count = 0;
-
-    while((mv != NO_MOVE) && (count < depth)) {
-
-        //assert(count < MAX_SEARCH_DEPTH);
-
-        make_move(pos, mv);
-        pos->pv_line[count++] = mv;
-
-        mv = probe_tt(pos->board_hash);
-    }
-
-    // rollback moves
-    while(pos->ply > 0) {
-        take_move(pos);
-    }
-
-    return count;
-}
-
-
 mv_bitmap get_best_pvline(const struct position *pos){
 	return get_pvline(pos, 0);
 }
@@ -271,12 +268,17 @@ void set_pvline(struct position *pos, uint8_t search_depth, mv_bitmap move){
 
 void update_board_hash(struct position *pos){
 	pos->board_hash = get_position_hash(pos);
+	pos->pawn_hash = get_pawn_position_hash(pos);
 }
 
 uint64_t get_board_hash(const struct position *pos){
 	return pos->board_hash;
 }
 
+uint64_t get_pawn_hash(const struct position *pos){
+	return pos->pawn_hash;
+}
+
 enum piece get_piece_on_square(const struct position *pos, enum square sq){
 	return pos->pieces[sq];
 }
@@ -317,15 +319,13 @@ const struct bitboards * get_bitboard_struct(const struct position *pos){
 
 
 
+// the killer is stored without its move ordering score, so it matches
+// the moves as they're generated
 void shuffle_search_killers(struct position *pos, mv_bitmap mv){
 
 	pos->search_killers[1][pos->ply] = pos->search_killers[0][pos->ply];
-    pos->search_killers[0][pos->ply] = mv;
-
-}
+    pos->search_killers[0][pos->ply] = get_move(mv);
 
-void add_to_search_history(struct position *pos, enum piece pce, enum square to_sq, uint8_t depth){
-	pos->search_history[pce][to_sq] += depth;
 }
 
 
@@ -373,18 +373,15 @@ void assert_boards_are_equal(const struct position *pos1, const struct position
     }
 
     assert(get_board_hash(pos1) == get_board_hash(pos2));
+    assert(get_pawn_hash(pos1) == get_pawn_hash(pos2));
 
 }
 
 
-mv_bitmap get_search_killer(struct position *pos, uint8_t killer_move_num, uint8_t ply){
+mv_bitmap get_search_killer(const struct position *pos, uint8_t killer_move_num, uint8_t ply){
 	return pos->search_killers[killer_move_num][ply];
 }
 
-uint32_t get_search_history(struct position *pos, enum piece pce, enum square sq){
-	return pos->search_history[pce][sq];
-}
-
 
 /*
  * Clones the given board. Returns malloc'ed memory that needs to be free'd
@@ -484,6 +481,23 @@ void push_history(struct position *pos, mv_bitmap move){
     pos->history_ply++;
 }
 
+// returns the last move made, NO_MOVE for a null move or if there's no history
+mv_bitmap get_previous_move(const struct position *pos){
+    if (pos->history_ply == 0) {
+        return NO_MOVE;
+    }
+    return pos->history[pos->history_ply - 1].move;
+}
+
+// returns the move made the given number of plies ago (1 => the last
+// move), NO_MOVE for a null move or if the history doesn't go back that far
+mv_bitmap get_earlier_move(const struct position *pos, uint8_t plies_ago){
+    if (pos->history_ply < plies_ago) {
+        return NO_MOVE;
+    }
+    return pos->history[pos->history_ply - plies_ago].move;
+}
+
 mv_bitmap pop_history(struct position *pos){
 
     pos->ply--;
@@ -518,11 +532,15 @@ void move_piece(struct position *pos, enum square from, enum square to)
             // easiest way to move a pawn
             remove_white_pawn_info(pos, from);
             add_pawn_info(pos, WHITE, to);
+            pos->pawn_hash ^= get_piece_hash(pce, from);
+            pos->pawn_hash ^= get_piece_hash(pce, to);
 			break;
 		case B_PAWN:
             // easiest way to move a pawn
             remove_black_pawn_info(pos, from);
             add_pawn_info(pos, BLACK, to);
+            pos->pawn_hash ^= get_piece_hash(pce, from);
+            pos->pawn_hash ^= get_piece_hash(pce, to);
             break;
 		case W_KING:
             pos->king_sq[WHITE] = to;
@@ -551,9 +569,11 @@ void add_piece_to_board(struct position *pos, enum piece pce, enum square sq)
     switch (pce) {
     case W_PAWN:
         add_pawn_info(pos, WHITE, sq);
+        pos->pawn_hash ^= get_piece_hash(pce, sq);
         break;
     case B_PAWN:
         add_pawn_info(pos, BLACK, sq);
+        pos->pawn_hash ^= get_piece_hash(pce, sq);
         break;
     case W_KING:
     case B_KING:
@@ -598,9 +618,11 @@ void remove_piece_from_board(struct position *pos, enum piece pce_to_remove, enu
     switch (pce_to_remove) {
     case W_PAWN:
         remove_white_pawn_info(pos, sq);
+        pos->pawn_hash ^= get_piece_hash(pce_to_remove, sq);
         break;
     case B_PAWN:
         remove_black_pawn_info(pos, sq);
+        pos->pawn_hash ^= get_piece_hash(pce_to_remove, sq);
         break;
     case W_KING:
     case B_KING:
@@ -728,34 +750,46 @@ bool make_move(struct position *pos, mv_bitmap mv)
 
     push_history(pos, mv);
 
-    if (IS_PAWN(pce_being_moved)){
-        make_pawn_move(pos, mv);
+    // hash out any existing en passant square
+    if (pos->en_passant != NO_SQUARE) {
+        pos->board_hash ^= get_en_passant_hash(pos->en_passant);
+        pos->en_passant = NO_SQUARE;
     }
 
+    pos->fifty_move_counter++;
+
     if (IS_CASTLE_MOVE(mv)) {
         make_castle_move(pos, mv);
     }
 
-
-    pos->en_passant = NO_SQUARE;
-    pos->fifty_move_counter++;
-
     if (IS_CAPTURE_MOVE(mv)) {
         enum piece capt = pos->pieces[to];
         remove_piece_from_board(pos, capt, to);
         pos->fifty_move_counter = 0;
     }
 
-    pos->ply++;
-    pos->history_ply++;
-
-
     move_piece(pos, from, to);
 
+    if (IS_PAWN(pce_being_moved)) {
+        make_pawn_move(pos, mv);
+    }
+
+    // update castle permissions (any move to/from a king or rook
+    // square can remove them)
+    pos->board_hash ^= get_castle_hash(pos->castle_perm);
+    pos->castle_perm &= castle_permission_mask[from];
+    pos->castle_perm &= castle_permission_mask[to];
+    pos->board_hash ^= get_castle_hash(pos->castle_perm);
 
     // flip side
     flip_sides(pos);
 
+    // the hashes are now final, so start pulling in the TT and cache
+    // entries for the new position while the legality check is being done
+    prefetch_tt(pos->board_hash);
+    prefetch_eval_cache(pos->board_hash);
+    prefetch_pawn_table(pos->pawn_hash);
+
     // check if move is valid (ie, king in check)
     enum square king_sq = pos->king_sq[side];
 
@@ -769,14 +803,12 @@ bool make_move(struct position *pos, mv_bitmap mv)
 }
 
 
+// moves the rook associated with the castle move. The king is
+// moved as part of the main move.
 static void make_castle_move(struct position *pos, mv_bitmap mv){
 
-    enum square from = FROMSQ(mv);
     enum square to = TOSQ(mv);
 
-    // hash out existing castle permissions
-    pos->board_hash ^= get_castle_hash(pos->castle_perm);
-
     switch (to) {
     case c1:
         move_piece(pos, a1, d1);
@@ -795,13 +827,11 @@ static void make_castle_move(struct position *pos, mv_bitmap mv){
         assert(false);
         break;
     }
-    // re-hash back in the new castle permissions
-    pos->castle_perm &= castle_permission_mask[from];
-    pos->castle_perm &= castle_permission_mask[to];
-    pos->board_hash ^= get_castle_hash(pos->castle_perm);
 }
 
 
+// handles the pawn-specific parts of the move. The pawn has already
+// been moved to the 'to' square.
 static void make_pawn_move(struct position *pos, mv_bitmap mv){
 
     enum square from = FROMSQ(mv);
@@ -828,10 +858,11 @@ static void make_pawn_move(struct position *pos, mv_bitmap mv){
         }
         pos->board_hash ^= get_en_passant_hash(pos->en_passant);
     }
+
     enum piece promoted = PROMOTED_PCE(mv);
     if (promoted != NO_PIECE) {
-        enum piece capt = pos->pieces[to];
-        remove_piece_from_board(pos, capt, to);
+        enum piece pawn = pos->pieces[to];
+        remove_piece_from_board(pos, pawn, to);
         add_piece_to_board(pos, promoted, to);
     }
 }
@@ -844,40 +875,36 @@ inline void take_move(struct position *pos)
     pos->history_ply--;
     pos->ply--;
 
-    mv_bitmap mv = pos->history[pos->history_ply].move;
+    const struct undo *undo = &pos->history[pos->history_ply];
+    mv_bitmap mv = undo->move;
 
     // note: when reverting, the 'from' square will be empty and the 'to'
     // square has the piece in it.
     enum square from = FROMSQ(mv);
     enum square to = TOSQ(mv);
 
-    // hash out en passant and castle if set
-    if (pos->en_passant != NO_SQUARE) {
-        pos->board_hash ^= get_en_passant_hash(pos->en_passant);
-    }
-
-    pos->board_hash ^= get_castle_hash(pos->castle_perm);
-
-    pos->castle_perm = pos->history[pos->history_ply].castle_perm;
-    pos->fifty_move_counter = pos->history[pos->history_ply].fifty_move_counter;
-    pos->en_passant = pos->history[pos->history_ply].en_passant;
+    // flip side
+    pos->side_to_move = GET_OPPOSITE_SIDE(pos->side_to_move);
 
-    // now, hash back in
-    if (pos->en_passant != NO_SQUARE) {
-        pos->board_hash ^= get_en_passant_hash(pos->en_passant);
+    enum piece promoted = PROMOTED_PCE(mv);
+    if (promoted != NO_PIECE) {
+        enum piece pawn = (GET_COLOUR(promoted) == WHITE) ? W_PAWN : B_PAWN;
+        remove_piece_from_board(pos, promoted, to);
+        add_piece_to_board(pos, pawn, to);
     }
-    pos->board_hash ^= get_castle_hash(pos->castle_perm);
 
-    // flip side
-    flip_sides(pos);
+    // note: to revert move, move piece from 'to' to 'from'
+    move_piece(pos, to, from);
 
-    if (MFLAG_EN_PASSANT & mv) {
+    if (IS_EN_PASS_MOVE(mv)) {
         if (pos->side_to_move == WHITE) {
             add_piece_to_board(pos, B_PAWN, to - 8);
         } else {
             add_piece_to_board(pos, W_PAWN, to + 8);
         }
-    } else if (MFLAG_CASTLE & mv) {
+    } else if (IS_CAPTURE_MOVE(mv)) {
+        add_piece_to_board(pos, CAPTURED_PCE(mv), to);
+    } else if (IS_CASTLE_MOVE(mv)) {
         switch (to) {
         case c1:
             move_piece(pos, d1, a1);
@@ -896,26 +923,63 @@ inline void take_move(struct position *pos)
             break;
         }
     }
-    // note: to revert move, move piece from 'to' to 'from'
-    move_piece(pos, to, from);
 
-    enum piece captured = CAPTURED_PCE(mv);
-    if (captured != NO_PIECE) {
-        add_piece_to_board(pos, captured, to);
-    }
+    // restore the state saved before the move was made. The hash is
+    // restored rather than un-hashed, since the piece operations above
+    // have toggled it.
+    pos->castle_perm = undo->castle_perm;
+    pos->fifty_move_counter = undo->fifty_move_counter;
+    pos->en_passant = undo->en_passant;
+    pos->board_hash = undo->board_hash;
+}
 
-    enum piece promoted = PROMOTED_PCE(mv);
-    if (PROMOTED_PCE(mv) != NO_PIECE) {
-        enum colour prom_col = GET_COLOUR(promoted);
-        remove_piece_from_board(pos, promoted, from);
 
-        enum piece pce_to_add = (prom_col == WHITE) ? W_PAWN : B_PAWN;
-        add_piece_to_board(pos, pce_to_add, from);
+
+
+
+/*
+ * Passes the move to the other side, without moving a piece. Used by the
+ * null move search.
+ *
+ * name: make_null_move
+ * @param
+ * @return
+ *
+ */
+void make_null_move(struct position *pos)
+{
+    push_history(pos, NO_MOVE);
+
+    if (pos->en_passant != NO_SQUARE) {
+        pos->board_hash ^= get_en_passant_hash(pos->en_passant);
+        pos->en_passant = NO_SQUARE;
     }
+
+    pos->fifty_move_counter++;
+
+    flip_sides(pos);
+
+    prefetch_tt(pos->board_hash);
+}
+
+void take_null_move(struct position *pos)
+{
+    pop_history(pos);
+    pos->side_to_move = GET_OPPOSITE_SIDE(pos->side_to_move);
 }
 
 
+// true if the side has any pieces other than the king and pawns
+bool has_non_pawn_material(const struct position *pos, enum colour col)
+{
+    uint32_t num_pawns = 0;
+    for(uint8_t f = FILE_A; f <= FILE_H; f++) {
+        num_pawns += pos->pawns_on_file[col][f];
+    }
 
+    uint32_t king_and_pawns = GET_PIECE_VALUE(W_KING) + num_pawns * GET_PIECE_VALUE(W_PAWN);
+    return pos->material[col] > king_and_pawns;
+}
 
 
 inline void flip_sides(struct position *pos)
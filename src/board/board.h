@@ -98,11 +98,14 @@ enum square get_en_passant_sq(const struct position *pos);
 
 void update_board_hash(struct position *pos);
 uint64_t get_board_hash(const struct position *pos);
+uint64_t get_pawn_hash(const struct position *pos);
 
 enum piece get_piece_on_square(const struct position *pos, enum square sq);
 
 void push_history(struct position *pos, mv_bitmap move);
 mv_bitmap pop_history(struct position *pos);
+mv_bitmap get_previous_move(const struct position *pos);
+mv_bitmap get_earlier_move(const struct position *pos, uint8_t plies_ago);
 
 uint8_t get_ply(const struct position *pos);
 void set_ply(struct position *pos, uint8_t ply);
@@ -115,7 +118,6 @@ void assert_boards_are_equal(const struct position *pos1, const struct position
 mv_bitmap get_best_pvline(const struct position *pos);
 mv_bitmap get_pvline(const struct position *pos, uint8_t search_depth);
 void set_pvline(struct position *pos, uint8_t search_depth, mv_bitmap move);
-uint8_t populate_pv_line(struct position *pos, uint8_t depth);
 
 
 
@@ -125,6 +127,9 @@ uint8_t get_fifty_move_counter(const struct position *pos);
 bool make_move(struct position *pos, mv_bitmap mv);
 void take_move(struct position *pos);
 void flip_sides(struct position *pos);
+void make_null_move(struct position *pos);
+void take_null_move(struct position *pos);
+bool has_non_pawn_material(const struct position *pos, enum colour col);
 
 bool is_pawn_controlling_sq(const struct position *pos, enum colour col, enum square sq);
 uint8_t get_num_pawns_on_rank(const struct position *pos, enum colour col, enum rank rank);
@@ -139,12 +144,9 @@ bool is_piece_on_square(const struct position *pos, enum piece pce, enum square
 bool is_square_occupied(uint64_t bitboard, enum square sq);
 bool is_repetition(const struct position *pos);
 
-void init_search_history(struct position *pos);
 void init_search_killers(struct position *pos);
 
-mv_bitmap get_search_killer(struct position *pos, uint8_t killer_move_num, uint8_t ply);
-uint32_t get_search_history(struct position *pos, enum piece pce, enum square sq);
-void add_to_search_history(struct position *pos, enum piece pce, enum square to_sq, uint8_t depth);
+mv_bitmap get_search_killer(const struct position *pos, uint8_t killer_move_num, uint8_t ply);
 
 
 
@@ -155,7 +157,9 @@ const struct bitboards * get_bitboard_struct(const struct position *pos);
 struct position* init_game(char *fen);
 
 struct position* allocate_board(void);
+struct position* duplicate_board(const struct position *pos);
 void free_board(struct position *pos);
+void reset_board(struct position *pos);
 
 
 
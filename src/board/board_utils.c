@@ -240,6 +240,7 @@ bool ASSERT_BOARD_OK(const struct position *pos)
 
     // check on position key
     assert(get_board_hash(pos) == get_position_hash(pos));
+    assert(get_pawn_hash(pos) == get_pawn_position_hash(pos));
 
     return true;
 
@@ -0,0 +1,160 @@
+/*
+ * eval_cache.c
+ *
+ * ---------------------------------------------------------------------
+ * DESCRIPTION: A hashtable of static evaluations, indexed by the board
+ * hash. The same positions get evaluated many times across the
+ * iterative deepening passes, so this saves re-evaluating them.
+ *
+ * Entries are read and written without locking: each entry holds the
+ * data and (hash XOR data), so a partially written entry fails the
+ * hash check and is treated as a miss.
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "kestrel.h"
+#include "eval_cache.h"
+
+
+struct eval_entry {
+    uint64_t key;		// board hash XOR data
+    uint64_t data;		// score in the low 32 bits, plus EVAL_ENTRY_VALID
+};
+
+// set in 'data' so that a valid entry is never all-zero
+#define EVAL_ENTRY_VALID		(0x1ull << 32)
+
+
+static struct eval_entry *eval_cache = NULL;
+static uint32_t eval_cache_mask = 0;
+// per-thread, so the search threads don't contend on the counters
+static _Thread_local struct eval_cache_stats stats;
+
+
+/*
+ * Creates the eval cache. A size of zero disables the cache.
+ *
+ * name: create_eval_cache
+ * @param	size_in_bytes - the size of the cache
+ * @return
+ *
+ */
+void create_eval_cache(uint32_t size_in_bytes)
+{
+    dispose_eval_cache();
+
+    // round the number of entries down to a power of 2
+    uint32_t num_entries = 1;
+    while ((uint64_t)num_entries * 2 * sizeof(struct eval_entry) <= size_in_bytes) {
+        num_entries *= 2;
+    }
+
+    if ((uint64_t)num_entries * sizeof(struct eval_entry) > size_in_bytes) {
+        // too small to be of any use
+        return;
+    }
+
+    eval_cache = (struct eval_entry *)calloc(num_entries, sizeof(struct eval_entry));
+    if (eval_cache == NULL) {
+        printf("unable to allocate eval cache of %u bytes\n", size_in_bytes);
+        exit(-1);
+    }
+    eval_cache_mask = num_entries - 1;
+}
+
+void clear_eval_cache(void)
+{
+    if (eval_cache != NULL) {
+        memset(eval_cache, 0, (eval_cache_mask + 1) * sizeof(struct eval_entry));
+    }
+}
+
+void dispose_eval_cache(void)
+{
+    if (eval_cache != NULL) {
+        free(eval_cache);
+        eval_cache = NULL;
+        eval_cache_mask = 0;
+    }
+}
+
+
+/*
+ * Looks up the evaluation for the given hash.
+ *
+ * name: probe_eval_cache
+ * @param	board_hash - the position hash
+ * @param	score - populated with the cached score
+ * @return	true if the score was found, false otherwise
+ *
+ */
+bool probe_eval_cache(uint64_t board_hash, int32_t *score)
+{
+    if (eval_cache == NULL) {
+        return false;
+    }
+
+    const struct eval_entry *entry = &eval_cache[board_hash & eval_cache_mask];
+
+    uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    uint64_t key = __atomic_load_n(&entry->key, __ATOMIC_RELAXED);
+
+    stats.probes++;
+    if ((data & EVAL_ENTRY_VALID) == 0 || (key ^ data) != board_hash) {
+        return false;
+    }
+
+    stats.hits++;
+    *score = (int32_t)(uint32_t)(data & 0xFFFFFFFF);
+    return true;
+}
+
+void add_to_eval_cache(uint64_t board_hash, int32_t score)
+{
+    if (eval_cache == NULL) {
+        return;
+    }
+
+    struct eval_entry *entry = &eval_cache[board_hash & eval_cache_mask];
+
+    uint64_t data = (uint64_t)(uint32_t)score | EVAL_ENTRY_VALID;
+
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->key, board_hash ^ data, __ATOMIC_RELAXED);
+}
+
+void prefetch_eval_cache(uint64_t board_hash)
+{
+    if (eval_cache != NULL) {
+        __builtin_prefetch(&eval_cache[board_hash & eval_cache_mask]);
+    }
+}
+
+void get_eval_cache_stats(struct eval_cache_stats *s)
+{
+    *s = stats;
+}
+
+void reset_eval_cache_stats(void)
+{
+    memset(&stats, 0, sizeof(struct eval_cache_stats));
+}
@@ -0,0 +1,35 @@
+/*
+ * eval_cache.h
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "kestrel.h"
+
+struct eval_cache_stats {
+    uint64_t probes;
+    uint64_t hits;
+};
+
+void create_eval_cache(uint32_t size_in_bytes);
+void clear_eval_cache(void);
+void dispose_eval_cache(void);
+bool probe_eval_cache(uint64_t board_hash, int32_t *score);
+void add_to_eval_cache(uint64_t board_hash, int32_t score);
+void prefetch_eval_cache(uint64_t board_hash);
+void get_eval_cache_stats(struct eval_cache_stats *stats);
+void reset_eval_cache_stats(void);
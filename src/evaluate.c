@@ -34,12 +34,18 @@
 #include "pieces.h"
 #include "move_gen.h"
 #include "move_gen_utils.h"
+#include "pawn_table.h"
+#include "eval_cache.h"
 
 
 static int32_t eval_piece(const struct position *pos, enum piece pce, const int8_t *pt);
 static int32_t eval_pawn_dependant_pieces(const struct position *pos, enum piece target_pce, enum piece pawn, const int32_t *adj_vals);
 static int32_t eval_paired_pieces(const struct position *pos, enum piece pce);
 static int32_t eval_pawn_shield(const struct position *pos, enum piece king);
+static int32_t eval_pawn_structure(const struct position *pos);
+static int32_t calc_position_score(const struct position *pos);
+static void populate_pawn_entry(const struct position *pos, struct pawn_entry *entry);
+static int32_t eval_pawns_for_colour(uint64_t pawns, enum colour col);
 
 
 /*****************************************************
@@ -130,10 +136,11 @@ static const int8_t MIRROR_PT[NUM_SQUARES] = {
 // knights are less valuable when there are fewer pawns
 // numbers obtained from :
 // http://chessprogramming.wikispaces.com/CPW-Engine_eval
-static const int32_t knight_adj[8] = { -16, -12, -8, -4,  0,  4,  8, 12};
+// (indexed by the number of pawns, 0-8)
+static const int32_t knight_adj[9] = { -20, -16, -12, -8, -4,  0,  4,  8, 12};
 
 // rooks are less valuable when there are more pawns
-static const int32_t rook_adj[8] =   {12,  9,  6,  3,  0, -3, -6, -9};
+static const int32_t rook_adj[9] =   {15, 12,  9,  6,  3,  0, -3, -6, -9};
 
 // define additional score values based on having paired pieces
 // these values are taken from:
@@ -166,6 +173,9 @@ struct eval_info {
 
 };
 
+#define FILE_A_BB	0x0101010101010101ull
+#define FILE_H_BB	0x8080808080808080ull
+
 // TODO:
 // additional eval elements to be added:
 //		- mobility
@@ -174,13 +184,41 @@ struct eval_info {
 // 		- blockages (eg, bad bishops)
 
 /*
+ * Evaluates the position, from the point of view of the side to move.
+ * The eval cache is checked first.
  *
  * name: evaluate_position
  * @param
- * @return >0 for white, <0 for black
+ * @return >0 if the side to move is better
  *
  */
 int32_t evaluate_position(const struct position *pos)
+{
+    uint64_t board_hash = get_board_hash(pos);
+    int32_t score = 0;
+
+    if (probe_eval_cache(board_hash, &score)) {
+#ifdef ENABLE_ASSERTS
+        // cached and fresh evaluations must be identical
+        assert(score == calc_position_score(pos));
+#endif
+        return score;
+    }
+
+    score = calc_position_score(pos);
+    add_to_eval_cache(board_hash, score);
+    return score;
+}
+
+
+/*
+ *
+ * name: calc_position_score
+ * @param
+ * @return >0 if the side to move is better
+ *
+ */
+static int32_t calc_position_score(const struct position *pos)
 {
     // initially based on material value
 	int32_t white_material = get_material_value(pos, WHITE);
@@ -193,11 +231,12 @@ int32_t evaluate_position(const struct position *pos)
     //
 
 
+    // pawn structure (including pawn position)
+    // ========================================
+    score += eval_pawn_structure(pos);
+
     // adjust for piece position
     // =========================
-    score += eval_piece(pos, W_PAWN, PAWN_PT);
-    score -= eval_piece(pos, B_PAWN, PAWN_PT);
-
     score += eval_piece(pos, W_BISHOP, BISHOP_PT);
     score -= eval_piece(pos, B_BISHOP, BISHOP_PT);
 
@@ -418,6 +457,103 @@ inline static int32_t eval_pawn_shield(const struct position *pos, enum piece ki
 }
 
 
+// returns the pawn structure score, using the pawn table where possible
+static int32_t eval_pawn_structure(const struct position *pos)
+{
+    struct pawn_entry *entry = NULL;
+
+    if (probe_pawn_table(get_pawn_hash(pos), &entry) == false) {
+        if (entry == NULL) {
+            // no table for this thread
+            struct pawn_entry uncached;
+            populate_pawn_entry(pos, &uncached);
+            return uncached.score;
+        }
+        populate_pawn_entry(pos, entry);
+    }
+
+#ifdef ENABLE_ASSERTS
+    // verify the cached entry against a freshly calculated one
+    struct pawn_entry fresh;
+    populate_pawn_entry(pos, &fresh);
+    assert(fresh.score == entry->score);
+    assert(fresh.passed_pawns[WHITE] == entry->passed_pawns[WHITE]);
+    assert(fresh.passed_pawns[BLACK] == entry->passed_pawns[BLACK]);
+#endif
+
+    return entry->score;
+}
 
 
+static inline uint64_t north_fill(uint64_t bb)
+{
+    bb |= (bb << 8);
+    bb |= (bb << 16);
+    bb |= (bb << 32);
+    return bb;
+}
 
+static inline uint64_t south_fill(uint64_t bb)
+{
+    bb |= (bb >> 8);
+    bb |= (bb >> 16);
+    bb |= (bb >> 32);
+    return bb;
+}
+
+static inline uint64_t east_one(uint64_t bb)
+{
+    return (bb << 1) & ~FILE_A_BB;
+}
+
+static inline uint64_t west_one(uint64_t bb)
+{
+    return (bb >> 1) & ~FILE_H_BB;
+}
+
+
+// works out the pawn structure terms for the position, and stores
+// them in the given pawn table entry
+static void populate_pawn_entry(const struct position *pos, struct pawn_entry *entry)
+{
+   	const struct bitboards *bb_str = get_bitboard_struct(pos);
+
+    uint64_t w_pawns = get_bitboard_for_piece(bb_str, W_PAWN);
+    uint64_t b_pawns = get_bitboard_for_piece(bb_str, B_PAWN);
+
+    // squares in front of the pawns, on the same file
+    uint64_t w_front_span = north_fill(w_pawns << 8);
+    uint64_t b_front_span = south_fill(b_pawns >> 8);
+
+    entry->attack_spans[WHITE] = east_one(w_front_span) | west_one(w_front_span);
+    entry->attack_spans[BLACK] = east_one(b_front_span) | west_one(b_front_span);
+
+    // a pawn is passed if there are no opposing pawns in front of it on
+    // the same or adjacent files
+    entry->passed_pawns[WHITE] = w_pawns & ~(b_front_span | entry->attack_spans[BLACK]);
+    entry->passed_pawns[BLACK] = b_pawns & ~(w_front_span | entry->attack_spans[WHITE]);
+
+    entry->score = eval_pawns_for_colour(w_pawns, WHITE)
+                   - eval_pawns_for_colour(b_pawns, BLACK);
+
+    entry->pawn_hash = get_pawn_hash(pos);
+}
+
+
+static int32_t eval_pawns_for_colour(uint64_t pawns, enum colour col)
+{
+    int32_t score = 0;
+
+    // pawn position
+    uint64_t bb = pawns;
+    while (bb != 0) {
+        enum square sq = pop_1st_bit(&bb);
+        if (col == WHITE) {
+            score += PAWN_PT[sq];
+        } else {
+            score += PAWN_PT[MIRROR_SQUARE(sq)];
+        }
+    }
+
+    return score;
+}
@@ -28,7 +28,6 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 #include <assert.h>
 #include "kestrel.h"
 #include "board.h"
@@ -51,11 +50,16 @@ struct zobrist {
     uint64_t en_passant_keys[NUM_SQUARES];
 };
 
-
 static struct zobrist st_zobrist;
 
+// state of the random number generator used to generate the keys
+static uint64_t rand_state = ZOBRIST_FIXED_SEED;
+
 /*
- * Initialises hashkeys with random numbers
+ * Initialises hashkeys with random numbers, using the fixed seed. The
+ * keys are therefore the same from run to run (and from process to
+ * process), so position hashes can be stored and reused.
+ *
  * name: init_hash_keys
  * @param
  * @return
@@ -63,9 +67,25 @@ static struct zobrist st_zobrist;
  */
 void init_hash_keys()
 {
+    init_hash_keys_with_seed(ZOBRIST_FIXED_SEED);
+}
+
+
+/*
+ * Initialises hashkeys with random numbers generated from the
+ * given seed.
+ *
+ * name: init_hash_keys_with_seed
+ * @param	seed - the seed for the random number generator (non-zero)
+ * @return
+ *
+ */
+void init_hash_keys_with_seed(uint64_t seed)
+{
+    assert(seed != 0);
+
     // reset the seed for the RNG
-    time_t now = time(0);
-    srand((unsigned int)now);
+    rand_state = seed;
 
     for (int pce = 0; pce < NUM_PIECES; pce++) {
         for (int sq = 0; sq < NUM_SQUARES; sq++) {
@@ -82,8 +102,31 @@ void init_hash_keys()
     for (int i = 0; i < NUM_SQUARES; i++) {
         st_zobrist.en_passant_keys[i] = generate_rand64();
     }
+}
 
 
+/*
+ * Returns a value derived from the full set of keys. Hashes generated
+ * from different key sets aren't compatible, so this can be used
+ * to check hashes stored outside the process.
+ *
+ * name: get_hash_key_signature
+ * @param
+ * @return	the signature
+ *
+ */
+uint64_t get_hash_key_signature(void)
+{
+    const uint64_t *keys = (const uint64_t *)&st_zobrist;
+    size_t num_keys = sizeof(struct zobrist) / sizeof(uint64_t);
+
+    // FNV-1a over the keys
+    uint64_t retval = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < num_keys; i++) {
+        retval ^= keys[i];
+        retval *= 0x100000001b3ull;
+    }
+    return retval;
 }
 
 /* Returns the castle hashkey for a given castle permission map
@@ -163,32 +206,40 @@ uint64_t get_position_hash(const struct position *pos)
 }
 
 
-///////////////////////////////////
-////// NOTE ///////////////////////
-///////////////////////////////////
-// Replace the rand() with a predictable "random" number.
-// This has the advantage during debugging of always having the same
-// hash values for board positions.
-////////////////////////////////////////////////
+/* Given a board, return the hashkey of just the pawns. Uses the same
+ * keys as the position hash.
+ *
+ * name: 	get_pawn_position_hash
+ * @param:	ptr to a board struct
+ * @return:	the pawn hashkey
+ *
+ */
+uint64_t get_pawn_position_hash(const struct position *pos)
+{
+    uint64_t retval = 0;
+   	const struct bitboards *bb_str = get_bitboard_struct(pos);
 
+	uint64_t bb = get_bitboard_for_piece(bb_str, W_PAWN) | get_bitboard_for_piece(bb_str, B_PAWN);
 
-/*
-static uint64_t generate_rand64(void)
-{
-	// GNU C rand() generates a 32-bit
-	uint64_t retval = (uint64_t) rand();
-	retval |= (uint64_t) rand () << 32;
+	while(bb != 0){
+		enum square sq = pop_1st_bit(&bb);
+		enum piece pce = get_piece_on_square(pos, sq);
 
-	return retval;
+        retval ^= get_piece_hash(pce, sq);
+	}
+    return retval;
 }
-*/
-// see https://en.wikipedia.org/wiki/Linear_congruential_generator
+
+
+// xorshift64* generator, see https://en.wikipedia.org/wiki/Xorshift
+// (the low bits are as random as the high bits, which matters since the
+// low bits of the hash are used to index the hash tables)
 static uint64_t generate_rand64(void)
 {
-    static uint64_t next = 1;
-
-    next = next * 1103515245 + 12345;
-    return next;
+    rand_state ^= rand_state >> 12;
+    rand_state ^= rand_state << 25;
+    rand_state ^= rand_state >> 27;
+    return rand_state * 0x2545F4914F6CDD1Dull;
 }
 
 
@@ -17,8 +17,14 @@
  */
 #pragma once
 
+// seed used when generating the Zobrist keys
+#define ZOBRIST_FIXED_SEED		0x7F4A7C159E3779B9ull
+
 void init_hash_keys(void);
+void init_hash_keys_with_seed(uint64_t seed);
+uint64_t get_hash_key_signature(void);
 uint64_t get_position_hash(const struct position *pos);
+uint64_t get_pawn_position_hash(const struct position *pos);
 uint64_t get_castle_hash(uint8_t castle_map);
 uint64_t get_side_hash(void);
 uint64_t get_en_passant_hash(enum square sq);
@@ -39,6 +39,9 @@
 #include "move_gen.h"
 #include "move_gen_utils.h"
 #include "uci_protocol.h"
+#include "bench.h"
+#include "analysis_cache.h"
+#include "eval_cache.h"
 
 
 // sample game positions
@@ -60,8 +63,8 @@ int main(int argc, char **argv)
         printf("%d", **argv);
     }
 
-    // set process pri and cpu affinity for max performance
-    set_priority_and_affinity();
+    // set process pri for max performance
+    set_process_priority();
 
     do_uci_loop();
 
@@ -84,14 +87,19 @@ static void do_uci_loop()
     struct search_info si;
     init_search_struct(&si);
 
+    create_tt_table(uci_get_hash_size());
+    create_eval_cache(uci_get_eval_cache_size());
 
     uci_print_hello();
 
+    // this thread only reads and acts on commands; "go" starts the
+    // search in a thread of its own (see uci_start_search())
     while (true) {
         memset(&line[0], 0, sizeof(line));
         fflush(stdout);
         if (!fgets(line, INPUTBUFFER, stdin)) {
-            continue;
+            // stdin has been closed, so there'll be no "quit"
+            break;
         }
 
         if (line[0] == '\n') {
@@ -99,23 +107,41 @@ static void do_uci_loop()
         }
 
         if (!strncmp(line, "isready", 7)) {
+            // answered straight away, even while searching
             uci_print_ready();
-            continue;
+        } else if (!strncmp(line, "stop", 4)) {
+            uci_stop_search(&si);
+        } else if (!strncmp(line, "ponderhit", 9)) {
+            uci_ponderhit(&si);
         } else if (!strncmp(line, "position", 8)) {
+            uci_stop_search(&si);
             uci_parse_position(line, pos);
         } else if (!strncmp(line, "ucinewgame", 10)) {
+            uci_stop_search(&si);
             uci_parse_position("position startpos\n", pos);
-//        } else if (!strncmp(line, "go", 2)) {
-//            ParseGo(line, info, pos);
+            clear_tt_table();
+            clear_eval_cache();
+            clear_search_pawn_tables();
+            seed_tt_from_analysis_cache();
+        } else if (!strncmp(line, "setoption", 9)) {
+            uci_stop_search(&si);
+            uci_parse_setoption(line);
+        } else if (!strncmp(line, "go", 2)) {
+            uci_start_search(line, &si, pos);
+        } else if (!strncmp(line, "bench", 5)) {
+            uci_stop_search(&si);
+            uci_parse_bench(line);
         } else if (!strncmp(line, "quit", 4)) {
-            si.stop_search = true;
             break;
         } else if (!strncmp(line, "uci", 3)) {
             uci_print_hello();
         }
-        if (si.stop_search == true) {
-            break;
-        }
     }
+    uci_stop_search(&si);
+
+    close_analysis_cache();
+    dispose_eval_cache();
+    dispose_search_pawn_tables();
+    dispose_tt_table();
     free_board(pos);
 }
@@ -0,0 +1,556 @@
+/*
+ * mate_search.c
+ *
+ * ---------------------------------------------------------------------
+ * DESCRIPTION: A mate solver, for "go mate N", using depth-first
+ * proof-number search (df-pn).
+ *
+ * Each node has a proof number and a disproof number: the least number
+ * of leaf nodes that have to be solved to prove (or disprove) that the
+ * side to move at the root can mate within the given number of moves.
+ * The search always expands the most-proving node, ie, it follows the
+ * attacking moves that look easiest to prove, and the defending moves
+ * that look hardest. This finds forcing mates with far fewer nodes than
+ * alpha-beta, which has to search every defence at full depth.
+ *
+ * The numbers are held in the negamax form : phi is the proof number
+ * for the side to move, delta the disproof number. So a node that's a
+ * win for the side to move has phi = 0 and delta = infinity.
+ *
+ * Being depth-first, the search only keeps the current path on the
+ * stack. Everything else is in the PN table, which is keyed on the
+ * position and the plies left for the mate. A solved node also solves
+ * the same position with more plies left (a proof) or fewer plies left
+ * (a disproof). The table is a fixed size. When it gets full, the
+ * entries with the smallest subtrees, ie, those that are cheapest to
+ * search again, are garbage collected.
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "kestrel.h"
+#include "mate_search.h"
+#include "attack.h"
+#include "board.h"
+#include "pieces.h"
+#include "move_gen.h"
+#include "move_gen_utils.h"
+
+
+// phi/delta of a solved node. Sums are capped here, so they can't overflow
+#define PN_INFINITY			100000000u
+
+// entries per PN table bucket
+#define PN_BUCKET_SIZE		4
+
+// garbage collection starts when the table is this full, and removes the
+// entries with the least work below them until it's down to the target
+#define PN_GC_TRIGGER_PCT	90
+#define PN_GC_TARGET_PCT	60
+
+// the "1 + epsilon" trick : a child is searched until its delta passes
+// the second best child's by this fraction, rather than by 1, so the
+// search doesn't keep switching between two similar children
+#define PN_EPSILON_DIVISOR	4
+
+
+struct pn_entry {
+    uint64_t hash;					// 0 => empty
+    uint32_t phi;
+    uint32_t delta;
+    uint32_t work;					// nodes searched below the entry
+    uint8_t plies;					// plies left for the mate
+    uint8_t dist;					// for a solved node, plies to the end of the line
+};
+
+struct pn_values {
+    uint32_t phi;
+    uint32_t delta;
+    uint8_t dist;
+};
+
+struct pn_child {
+    mv_bitmap move;
+    uint64_t hash;					// hash of the position after the move
+};
+
+
+static void dfpn(struct position *pos, uint8_t plies, uint32_t th_phi, uint32_t th_delta,
+                 struct pn_values *values);
+static uint16_t get_legal_children(struct position *pos, struct pn_child *children);
+static void get_child_values(const struct pn_child *child, uint8_t plies, struct pn_values *values);
+static uint8_t get_mating_line(struct position *pos, uint8_t plies, mv_bitmap *pv_line);
+static bool create_pn_table(uint32_t size_in_bytes);
+static void dispose_pn_table(void);
+static bool probe_pn_table(uint64_t hash, uint8_t plies, struct pn_values *values);
+static void add_to_pn_table(uint64_t hash, uint8_t plies, const struct pn_values *values, uint32_t work);
+static void collect_garbage(void);
+static inline bool is_in_check(const struct position *pos);
+static inline bool is_stopped(void);
+
+
+static struct pn_entry *pn_table = NULL;
+static uint32_t pn_num_buckets = 0;				// always a power of 2
+static uint32_t pn_num_entries = 0;
+static uint32_t pn_used_entries = 0;
+
+// the search being run
+static struct search_info *mate_si = NULL;
+static bool mate_search_stopped = false;
+
+
+/*
+ * Searches for a mate by the side to move, in at most the given number
+ * of moves. The search stops early if the search info's stop flag is
+ * set, or its node limit is reached.
+ *
+ * name: search_mate
+ * @param	pos - the position
+ * @param	si - the search info, for the node count and stop conditions
+ * @param	mate_in_moves - the number of moves to mate in
+ * @param	table_size_in_bytes - size of the PN table
+ * @param	result - populated with the mating line, if any
+ * @return	true if a mate was found, false otherwise
+ *
+ */
+bool search_mate(struct position *pos, struct search_info *si, uint8_t mate_in_moves,
+                 uint32_t table_size_in_bytes, struct mate_search_result *result)
+{
+    memset(result, 0, sizeof(struct mate_search_result));
+
+    if (mate_in_moves == 0) {
+        return false;
+    }
+    if (mate_in_moves > MATE_SEARCH_MAX_MOVES) {
+        mate_in_moves = MATE_SEARCH_MAX_MOVES;
+    }
+
+    if (create_pn_table(table_size_in_bytes) == false) {
+        printf("info string unable to allocate the mate search table\n");
+        return false;
+    }
+
+    mate_si = si;
+    mate_search_stopped = false;
+
+    // the attacker moves at the root, and makes the last move of the line
+    uint8_t plies = (uint8_t)(2 * mate_in_moves - 1);
+    struct pn_values root;
+    dfpn(pos, plies, PN_INFINITY, PN_INFINITY, &root);
+
+    if (mate_search_stopped == false && root.phi == 0) {
+        result->mate_found = true;
+        result->mate_plies = root.dist;
+        result->pv_length = get_mating_line(pos, plies, result->pv_line);
+    }
+
+    dispose_pn_table();
+    mate_si = NULL;
+
+    return result->mate_found;
+}
+
+
+/*
+ * Searches a node until it's solved, or its phi or delta reaches the
+ * given threshold. The child with the smallest delta (ie, the one that
+ * looks easiest to prove a win for the side to move) is searched, with
+ * thresholds that send the search back here as soon as another child
+ * becomes more promising.
+ *
+ * name: dfpn
+ * @param	pos - the position
+ * @param	plies - the plies left for the mate
+ * @param	th_phi, th_delta - the thresholds
+ * @param	values - populated with the node's phi and delta
+ * @return
+ *
+ */
+static void dfpn(struct position *pos, uint8_t plies, uint32_t th_phi, uint32_t th_delta,
+                 struct pn_values *values)
+{
+    mate_si->num_nodes++;
+    if (is_stopped()) {
+        mate_search_stopped = true;
+        return;
+    }
+
+    uint64_t hash = get_board_hash(pos);
+    uint64_t nodes_before = mate_si->num_nodes;
+
+    struct pn_child children[MAX_POSITION_MOVES];
+    uint16_t num_children = get_legal_children(pos, children);
+
+    if (num_children == 0 || plies == 0) {
+        values->dist = 0;
+        bool mover_loses;
+        if (num_children == 0 && is_in_check(pos)) {
+            mover_loses = true;
+        } else {
+            // stalemate, or the defender has survived. The attacker
+            // moves with an odd number of plies left.
+            bool is_attacker = (plies & 1) != 0;
+            mover_loses = is_attacker;
+        }
+        values->phi = mover_loses ? PN_INFINITY : 0;
+        values->delta = mover_loses ? 0 : PN_INFINITY;
+        add_to_pn_table(hash, plies, values, 1);
+        return;
+    }
+
+    // the child last searched. Its values are used directly, rather than
+    // read back from the table, in case they've been overwritten.
+    int32_t last_child = -1;
+    struct pn_values last_values = { .phi = 1, .delta = 1, .dist = 0 };
+
+    while (true) {
+        uint32_t phi = PN_INFINITY;
+        uint32_t delta = 0;
+        uint32_t delta_2 = PN_INFINITY;		// second smallest child delta
+        uint32_t best_phi = 0;
+        uint16_t best = 0;
+        uint8_t win_dist = UINT8_MAX;
+        uint8_t loss_dist = 0;
+
+        for(uint16_t i = 0; i < num_children; i++) {
+            struct pn_values cv;
+            if ((int32_t)i == last_child) {
+                cv = last_values;
+            } else {
+                get_child_values(&children[i], (uint8_t)(plies - 1), &cv);
+            }
+
+            delta += cv.phi;
+            if (delta > PN_INFINITY) {
+                delta = PN_INFINITY;
+            }
+
+            if (cv.delta < phi) {
+                delta_2 = phi;
+                phi = cv.delta;
+                best = i;
+                best_phi = cv.phi;
+            } else if (cv.delta < delta_2) {
+                delta_2 = cv.delta;
+            }
+
+            // the quickest win, and the slowest loss
+            if (cv.delta == 0 && cv.dist < win_dist) {
+                win_dist = cv.dist;
+            }
+            if (cv.phi == 0 && cv.dist > loss_dist) {
+                loss_dist = cv.dist;
+            }
+        }
+
+        values->phi = phi;
+        values->delta = delta;
+        values->dist = 0;
+        if (phi == 0) {
+            values->dist = (uint8_t)(win_dist + 1);
+        } else if (delta == 0) {
+            values->dist = (uint8_t)(loss_dist + 1);
+        }
+
+        if (phi >= th_phi || delta >= th_delta) {
+            break;
+        }
+
+        // the child's delta is this node's phi, and its phi adds to this
+        // node's delta, so the thresholds come from this node's
+        uint32_t child_th_phi = PN_INFINITY;
+        if (th_delta < PN_INFINITY) {
+            child_th_phi = th_delta - delta + best_phi;
+        }
+        uint64_t child_th_delta = (uint64_t)delta_2 + 1 + delta_2 / PN_EPSILON_DIVISOR;
+        if (child_th_delta > th_phi) {
+            child_th_delta = th_phi;
+        }
+
+        make_move(pos, children[best].move);
+        dfpn(pos, (uint8_t)(plies - 1), child_th_phi, (uint32_t)child_th_delta, &last_values);
+        take_move(pos);
+        last_child = best;
+
+        if (mate_search_stopped) {
+            return;
+        }
+    }
+
+    uint64_t work = mate_si->num_nodes - nodes_before + 1;
+    add_to_pn_table(hash, plies, values, (work > UINT32_MAX) ? UINT32_MAX : (uint32_t)work);
+}
+
+
+// gets the legal moves, and the hash of the position after each one
+static uint16_t get_legal_children(struct position *pos, struct pn_child *children)
+{
+    struct move_list mvl = {
+        .moves = {0},
+        .move_count = 0
+    };
+    generate_all_moves(pos, &mvl);
+
+    uint16_t count = 0;
+    for(uint16_t i = 0; i < mvl.move_count; i++) {
+        if (make_move(pos, mvl.moves[i])) {
+            children[count].move = mvl.moves[i];
+            children[count].hash = get_board_hash(pos);
+            count++;
+            take_move(pos);
+        }
+    }
+    return count;
+}
+
+
+// an unexpanded child starts with phi = delta = 1
+static void get_child_values(const struct pn_child *child, uint8_t plies, struct pn_values *values)
+{
+    if (probe_pn_table(child->hash, plies, values) == false) {
+        values->phi = 1;
+        values->delta = 1;
+        values->dist = 0;
+    }
+}
+
+
+/*
+ * Follows the proof from the root : the attacker plays the quickest mate,
+ * and the defender the slowest.
+ *
+ * name: get_mating_line
+ * @param	pos - the root position
+ * @param	plies - the plies left for the mate at the root
+ * @param	pv_line - populated with the mating line
+ * @return	the number of moves in the line
+ *
+ */
+static uint8_t get_mating_line(struct position *pos, uint8_t plies, mv_bitmap *pv_line)
+{
+    uint8_t num_moves = 0;
+
+    while (plies > 0 && num_moves < MAX_SEARCH_DEPTH) {
+        struct pn_child children[MAX_POSITION_MOVES];
+        uint16_t num_children = get_legal_children(pos, children);
+
+        bool is_attacker = (plies & 1) != 0;
+        int32_t selected = -1;
+        uint8_t selected_dist = 0;
+
+        for(uint8_t attempt = 0; attempt < 2 && selected < 0; attempt++) {
+            if (attempt > 0) {
+                // the entries below here have been garbage collected, so
+                // solve the node again
+                struct pn_values values;
+                dfpn(pos, plies, PN_INFINITY, PN_INFINITY, &values);
+                if (mate_search_stopped) {
+                    break;
+                }
+            }
+
+            for(uint16_t i = 0; i < num_children; i++) {
+                struct pn_values cv;
+                if (probe_pn_table(children[i].hash, (uint8_t)(plies - 1), &cv) == false) {
+                    continue;
+                }
+                if (is_attacker && cv.delta == 0 && (selected < 0 || cv.dist < selected_dist)) {
+                    selected = i;
+                    selected_dist = cv.dist;
+                } else if (is_attacker == false && cv.phi == 0 && (selected < 0 || cv.dist > selected_dist)) {
+                    selected = i;
+                    selected_dist = cv.dist;
+                }
+            }
+        }
+
+        if (selected < 0) {
+            break;
+        }
+
+        pv_line[num_moves++] = children[selected].move;
+        make_move(pos, children[selected].move);
+        plies--;
+    }
+
+    for(uint8_t i = 0; i < num_moves; i++) {
+        take_move(pos);
+    }
+    return num_moves;
+}
+
+
+static bool create_pn_table(uint32_t size_in_bytes)
+{
+    dispose_pn_table();
+
+    // round the number of buckets down to a power of 2
+    size_t bucket_size = PN_BUCKET_SIZE * sizeof(struct pn_entry);
+    uint32_t num_buckets = 1;
+    while ((size_t)num_buckets * 2 * bucket_size <= size_in_bytes) {
+        num_buckets *= 2;
+    }
+
+    pn_table = calloc((size_t)num_buckets * PN_BUCKET_SIZE, sizeof(struct pn_entry));
+    if (pn_table == NULL) {
+        return false;
+    }
+    pn_num_buckets = num_buckets;
+    pn_num_entries = num_buckets * PN_BUCKET_SIZE;
+    pn_used_entries = 0;
+    return true;
+}
+
+
+static void dispose_pn_table(void)
+{
+    free(pn_table);
+    pn_table = NULL;
+    pn_num_buckets = 0;
+    pn_num_entries = 0;
+    pn_used_entries = 0;
+}
+
+
+/*
+ * Looks up a node. An entry for the same position with a different
+ * number of plies left can still be used if it's solved : a mate that
+ * has been proven is still a mate with more plies to spare, and a
+ * disproof still holds with fewer.
+ *
+ * name: probe_pn_table
+ * @param	hash - the position hash
+ * @param	plies - the plies left for the mate
+ * @param	values - populated with the stored values
+ * @return	true if the node was found, false otherwise
+ *
+ */
+static bool probe_pn_table(uint64_t hash, uint8_t plies, struct pn_values *values)
+{
+    const struct pn_entry *bucket = &pn_table[(hash & (pn_num_buckets - 1)) * PN_BUCKET_SIZE];
+
+    for(uint8_t i = 0; i < PN_BUCKET_SIZE; i++) {
+        const struct pn_entry *e = &bucket[i];
+        if (e->hash != hash) {
+            continue;
+        }
+
+        bool usable = (e->plies == plies);
+        if (usable == false) {
+            // the attacker moves with an odd number of plies left
+            bool is_attacker = (e->plies & 1) != 0;
+            bool proven = is_attacker ? (e->phi == 0) : (e->delta == 0);
+            bool disproven = is_attacker ? (e->delta == 0) : (e->phi == 0);
+            usable = (proven && e->plies < plies) || (disproven && e->plies > plies);
+        }
+
+        if (usable) {
+            values->phi = e->phi;
+            values->delta = e->delta;
+            values->dist = e->dist;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// a full bucket loses the entry with the least work below it
+static void add_to_pn_table(uint64_t hash, uint8_t plies, const struct pn_values *values, uint32_t work)
+{
+    struct pn_entry *bucket = &pn_table[(hash & (pn_num_buckets - 1)) * PN_BUCKET_SIZE];
+
+    struct pn_entry *slot = NULL;
+    for(uint8_t i = 0; i < PN_BUCKET_SIZE; i++) {
+        struct pn_entry *e = &bucket[i];
+        if (e->hash == hash && e->plies == plies) {
+            slot = e;
+            break;
+        }
+        if (e->hash == 0) {
+            if (slot == NULL || slot->hash != 0) {
+                slot = e;
+            }
+        } else if (slot == NULL || (slot->hash != 0 && e->work < slot->work)) {
+            slot = e;
+        }
+    }
+
+    if (slot->hash == 0) {
+        pn_used_entries++;
+    }
+    slot->hash = hash;
+    slot->phi = values->phi;
+    slot->delta = values->delta;
+    slot->work = work;
+    slot->plies = plies;
+    slot->dist = values->dist;
+
+    if ((uint64_t)pn_used_entries * 100 > (uint64_t)pn_num_entries * PN_GC_TRIGGER_PCT) {
+        collect_garbage();
+    }
+}
+
+
+/*
+ * Frees space in the PN table by removing the entries with the smallest
+ * subtrees. The work threshold doubles on each pass, until enough
+ * entries have gone.
+ *
+ * name: collect_garbage
+ * @param
+ * @return
+ *
+ */
+static void collect_garbage(void)
+{
+    uint64_t target = (uint64_t)pn_num_entries * PN_GC_TARGET_PCT / 100;
+
+    for(uint32_t threshold = 2; pn_used_entries > target; threshold *= 2) {
+        for(uint32_t i = 0; i < pn_num_entries; i++) {
+            struct pn_entry *e = &pn_table[i];
+            if (e->hash != 0 && e->work < threshold) {
+                memset(e, 0, sizeof(struct pn_entry));
+                pn_used_entries--;
+            }
+        }
+        if (threshold > UINT32_MAX / 2) {
+            break;
+        }
+    }
+}
+
+
+static inline bool is_in_check(const struct position *pos)
+{
+    enum colour side_to_move = get_side_to_move(pos);
+    return is_sq_attacked(pos, get_king_square(pos, side_to_move), GET_OPPOSITE_SIDE(side_to_move));
+}
+
+
+static inline bool is_stopped(void)
+{
+    // the mate search only uses one thread
+    if (mate_si->node_limit > 0 && mate_si->num_nodes >= mate_si->node_limit) {
+        return true;
+    }
+    return __atomic_load_n(&mate_si->stop_search, __ATOMIC_RELAXED);
+}
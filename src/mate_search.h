@@ -0,0 +1,37 @@
+/*
+ * mate_search.h
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "kestrel.h"
+#include "search.h"
+
+// longest mate that can be searched for, in moves
+#define MATE_SEARCH_MAX_MOVES	(MAX_SEARCH_DEPTH / 2)
+
+
+struct mate_search_result {
+    bool mate_found;				// true => the side to move mates
+    uint8_t mate_plies;				// length of the mating line, in plies
+    uint8_t pv_length;
+    mv_bitmap pv_line[MAX_SEARCH_DEPTH];
+};
+
+bool search_mate(struct position *pos, struct search_info *si, uint8_t mate_in_moves,
+                 uint32_t table_size_in_bytes, struct mate_search_result *result);
@@ -44,7 +44,7 @@
 static void init_mvv_lva_lookup(void);
 static void do_gen_moves(struct position *pos, struct move_list *mvl, const bool captures_only);
 static void add_capture_move(mv_bitmap move_bitmap, struct move_list *mvlist, enum piece attacker, enum piece victim);
-static void add_quiet_move(struct position *pos, mv_bitmap mv, struct move_list *mvlist, enum piece piece_being_moved);
+static void add_quiet_move(struct position *pos, mv_bitmap mv, struct move_list *mvlist);
 static void add_en_passant_move(mv_bitmap mv, struct move_list *mvlist);
 
 static void generate_white_pawn_moves(struct position *pos,
@@ -75,7 +75,7 @@ static void assert_move_ok(const struct position *pos, mv_bitmap mv);
 
 
 #ifdef ENABLE_ASSERTS
-static void assert_add_quiet_move(struct position *pos, mv_bitmap mv, enum piece pce_being_moved);
+static void assert_add_quiet_move(struct position *pos, mv_bitmap mv);
 static void assert_add_capture_move(struct position *pos, mv_bitmap mv);
 #endif
 
@@ -400,22 +400,18 @@ assert_add_capture_move(struct position *pos, mv_bitmap mv)
 static inline void
 add_quiet_move(struct position *pos,
                mv_bitmap mv,
-               struct move_list *mvlist,
-               enum piece piece_being_moved)
+               struct move_list *mvlist)
 {
 #ifdef ENABLE_ASSERTS
-    assert_add_quiet_move(pos, mv, piece_being_moved);
+    assert_add_quiet_move(pos, mv);
 #endif
 
-    // adjust score by killer moves and search history
+    // adjust score by killer moves. The search adds the history scores
+    // for the rest (see score_quiet_moves())
     if(get_search_killer(pos, 0, get_ply(pos)) == mv) {
         add_to_score(&mv, MOVE_ORDER_WEIGHT_KILLER_0);
     } else if(get_search_killer(pos, 1, get_ply(pos)) == mv) {
         add_to_score(&mv, MOVE_ORDER_WEIGHT_KILLER_1);
-    } else {
-        enum square to_sq = TOSQ(mv);
-
-        add_to_score(&mv, get_search_history(pos, piece_being_moved, to_sq));
     }
 
     mvlist->moves[mvlist->move_count] = mv;
@@ -424,7 +420,7 @@ add_quiet_move(struct position *pos,
 
 #ifdef ENABLE_ASSERTS
 static inline void
-assert_add_quiet_move(struct position *pos, mv_bitmap mv, enum piece piece_being_moved)
+assert_add_quiet_move(struct position *pos, mv_bitmap mv)
 {
     if (IS_CAPTURE_MOVE(mv)) {
         assert(false);
@@ -433,8 +429,6 @@ assert_add_quiet_move(struct position *pos, mv_bitmap mv, enum piece piece_being
 	enum square to_sq = TOSQ(mv);
     enum piece pce = get_piece_on_square(pos, to_sq);
 
-    assert(piece_being_moved != NO_PIECE);
-
 	// quiet move, so nothing on to square
 	assert(pce == NO_PIECE);
 
@@ -510,7 +504,7 @@ static inline void generate_knight_piece_moves(struct position *pos,
                 // loop creating quiet moves
                 enum square empty_sq = pop_1st_bit(&empty_squares);
                 mv_bitmap mv = MOVE_DEBUG(pos, knight_sq, empty_sq, NO_PIECE, NO_PIECE, MFLAG_NONE);
-                add_quiet_move(pos, mv, mvl, knight);
+                add_quiet_move(pos, mv, mvl);
             }
         }
     }
@@ -559,7 +553,7 @@ static inline void generate_king_moves(struct position *pos,
 
             mv_bitmap mv = MOVE_DEBUG(pos, king_sq, empty_sq, NO_PIECE, NO_PIECE, MFLAG_NONE);
 
-            add_quiet_move(pos, mv, mvl, king);
+            add_quiet_move(pos, mv, mvl);
         }
 
         // check for castling moves
@@ -590,7 +584,7 @@ static inline void generate_white_castle_moves(struct position *pos,
 
                 mv_bitmap mv = MOVE_DEBUG(pos, e1, g1, NO_PIECE,
                                     NO_PIECE, MFLAG_CASTLE);
-                add_quiet_move(pos, mv, mvl, W_KING);
+                add_quiet_move(pos, mv, mvl);
             }
         }
     }
@@ -606,7 +600,7 @@ static inline void generate_white_castle_moves(struct position *pos,
 
                 mv_bitmap mv = MOVE_DEBUG(pos, e1, c1, NO_PIECE,
                                     NO_PIECE, MFLAG_CASTLE);
-                add_quiet_move(pos, mv, mvl, W_KING);
+                add_quiet_move(pos, mv, mvl);
             }
         }
     }
@@ -628,7 +622,7 @@ static inline void generate_black_castle_moves(struct position *pos,
 
                 mv_bitmap mv = MOVE_DEBUG(pos, e8, g8, NO_PIECE,
                                     NO_PIECE, MFLAG_CASTLE);
-                add_quiet_move(pos, mv, mvl, B_KING);
+                add_quiet_move(pos, mv, mvl);
             }
         }
     }
@@ -643,7 +637,7 @@ static inline void generate_black_castle_moves(struct position *pos,
                     && !is_sq_attacked(pos, d8, WHITE)) {
 
                 mv_bitmap mv = MOVE_DEBUG(pos, e8, c8, NO_PIECE, NO_PIECE, MFLAG_CASTLE);
-                add_quiet_move(pos, mv, mvl, B_KING);
+                add_quiet_move(pos, mv, mvl);
             }
         }
     }
@@ -679,26 +673,26 @@ generate_white_pawn_moves(struct position *pos, struct move_list *mvl,
                 if (pawn_rank == RANK_7) {
                     // pawn can promote to 4 pieces
                     mv = MOVE_DEBUG(pos, pawn_sq, north_sq, NO_PIECE, W_QUEEN, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, W_PAWN);
+                    add_quiet_move(pos, mv, mvl);
 
                     mv = MOVE_DEBUG(pos, pawn_sq, north_sq, NO_PIECE, W_ROOK, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, W_PAWN);
+                    add_quiet_move(pos, mv, mvl);
 
                     mv = MOVE_DEBUG(pos, pawn_sq, north_sq, NO_PIECE, W_BISHOP, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, W_PAWN);
+                    add_quiet_move(pos, mv, mvl);
 
                     mv = MOVE_DEBUG(pos, pawn_sq, north_sq, NO_PIECE, W_KNIGHT, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, W_PAWN);
+                    add_quiet_move(pos, mv, mvl);
                 } else {
                     mv = MOVE_DEBUG(pos, pawn_sq, north_sq, NO_PIECE, NO_PIECE, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, W_PAWN);
+                    add_quiet_move(pos, mv, mvl);
                 }
 
                 if (pawn_rank == RANK_2) {
                     enum square north_x2 = pawn_sq + NN;
                     if (is_square_occupied(get_bitboard_all_pieces(bb), north_x2) == false) {
                         mv = MOVE_DEBUG(pos, pawn_sq, north_x2, NO_PIECE, NO_PIECE, MFLAG_PAWN_START);
-                        add_quiet_move(pos, mv, mvl, W_PAWN);
+                        add_quiet_move(pos, mv, mvl);
                     }
                 }
 
@@ -803,19 +797,19 @@ generate_black_pawn_moves(struct position *pos, struct move_list *mvl,
                 if (pawn_rank == RANK_2) {
                     // pawn can promote to 4 pieces
                     mv = MOVE_DEBUG(pos, pawn_sq, south_sq, NO_PIECE, B_QUEEN, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, B_PAWN);
+                    add_quiet_move(pos, mv, mvl);
 
                     mv = MOVE_DEBUG(pos, pawn_sq, south_sq, NO_PIECE, B_ROOK, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, B_PAWN);
+                    add_quiet_move(pos, mv, mvl);
 
                     mv = MOVE_DEBUG(pos, pawn_sq, south_sq, NO_PIECE, B_BISHOP, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, B_PAWN);
+                    add_quiet_move(pos, mv, mvl);
 
                     mv = MOVE_DEBUG(pos, pawn_sq, south_sq, NO_PIECE, B_KNIGHT, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, B_PAWN);
+                    add_quiet_move(pos, mv, mvl);
                 } else {
                     mv = MOVE_DEBUG(pos, pawn_sq, south_sq, NO_PIECE, NO_PIECE, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, B_PAWN);
+                    add_quiet_move(pos, mv, mvl);
                 }
                 if (pawn_rank == RANK_7) {
                     enum square south_x2 = pawn_sq + (enum square)SS;	// can skip down 2 ranks
@@ -823,7 +817,7 @@ generate_black_pawn_moves(struct position *pos, struct move_list *mvl,
                     bool sq_2_occupied = is_square_occupied(get_bitboard_all_pieces(bb), south_x2);
                     if (sq_2_occupied == false) {
                         mv = MOVE_DEBUG(pos, pawn_sq, south_x2,NO_PIECE, NO_PIECE,MFLAG_PAWN_START);
-                        add_quiet_move(pos, mv, mvl, B_PAWN);
+                        add_quiet_move(pos, mv, mvl);
                     }
                 }
 
@@ -922,11 +916,6 @@ static inline void generate_sliding_horizontal_vertical_moves (struct position *
     while (bb != 0) {
 
         enum square pce_sq = pop_1st_bit(&bb);
-        enum piece piece_being_moved = get_piece_on_square(pos, pce_sq);
-
-#ifdef ENABLE_ASSERTS
-        assert(piece_being_moved != NO_PIECE);
-#endif
 
         uint64_t hmask = GET_HORIZONTAL_MASK(pce_sq);
         uint64_t vmask = GET_VERTICAL_MASK(pce_sq);
@@ -967,7 +956,7 @@ static inline void generate_sliding_horizontal_vertical_moves (struct position *
             } else {
                 if (only_capture_moves == false) {
                     mv_bitmap mv = MOVE_DEBUG(pos, pce_sq, sq, NO_PIECE, NO_PIECE, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, piece_being_moved);
+                    add_quiet_move(pos, mv, mvl);
                 }
             }
         }
@@ -999,7 +988,6 @@ static inline void generate_sliding_diagonal_moves(struct position *pos,
     while (bb != 0) {
 
         enum square pce_sq = pop_1st_bit(&bb);
-        enum piece piece_being_moved = get_piece_on_square(pos, pce_sq);
 
         uint64_t posmask = GET_DIAGONAL_MASK(pce_sq);
         uint64_t negmask = GET_ANTI_DIAGONAL_MASK(pce_sq);
@@ -1041,7 +1029,7 @@ static inline void generate_sliding_diagonal_moves(struct position *pos,
             } else {
                 if (only_capture_moves == false) {
                     mv_bitmap mv = MOVE_DEBUG(pos, pce_sq, sq, NO_PIECE, NO_PIECE, MFLAG_NONE);
-                    add_quiet_move(pos, mv, mvl, piece_being_moved);
+                    add_quiet_move(pos, mv, mvl);
                 }
             }
         }
@@ -31,6 +31,9 @@ struct move_list {
 #define MOVE_ORDER_WEIGHT_CAPTURE		1000000
 #define MOVE_ORDER_WEIGHT_KILLER_0		900000
 #define MOVE_ORDER_WEIGHT_KILLER_1		800000
+#define MOVE_ORDER_WEIGHT_COUNTER_MOVE	700000
+// quiet moves are scored around this by the history tables (see move_history.c)
+#define MOVE_ORDER_WEIGHT_HISTORY		100000
 
 
 
@@ -0,0 +1,242 @@
+/*
+ * move_history.c
+ *
+ * ---------------------------------------------------------------------
+ * DESCRIPTION: The tables used to order the quiet moves, ie, the moves
+ * the capture and killer move ordering says nothing about.
+ *
+ * - history : how often a [piece][to square] move has been the best
+ *   quiet move at a node, regardless of the position.
+ * - counter moves : the quiet move that last refuted the previous move,
+ *   indexed by the [piece][to square] of the previous move.
+ * - continuation histories : as for the history, but for each
+ *   [piece][to square] of the move 1 ply back (and 2 plies back), so
+ *   they capture follow-up moves and replies.
+ *
+ * At the end of a node, the best quiet move gets a bonus, and the other
+ * quiet moves tried before it a malus. The update uses "gravity" : the
+ * change shrinks as the value approaches HISTORY_MAX, so the values stay
+ * bounded, and old results fade as new ones come in.
+ *
+ * Each search thread has its own tables.
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "kestrel.h"
+#include "board.h"
+#include "move_gen.h"
+#include "move_gen_utils.h"
+#include "move_history.h"
+
+
+// the bonus for the best move is HISTORY_BONUS_FACTOR * depth^2, up to
+// HISTORY_BONUS_MAX. The other quiet moves tried lose the same amount.
+#define HISTORY_BONUS_FACTOR		32
+#define HISTORY_BONUS_MAX			1200
+
+
+static inline void apply_gravity(int16_t *entry, int32_t bonus);
+static inline int32_t get_bonus(uint8_t depth);
+
+
+/*
+ * Allocates a set of tables, with all the values zero.
+ *
+ * name: create_move_history
+ * @param
+ * @return	the tables, to be released with dispose_move_history()
+ *
+ */
+struct move_history *create_move_history(void)
+{
+    // calloc, since most of the continuation history is never touched
+    struct move_history *mh = calloc(1, sizeof(struct move_history));
+    if (mh == NULL) {
+        printf("unable to allocate move history\n");
+        exit(-1);
+    }
+    return mh;
+}
+
+
+void dispose_move_history(struct move_history *mh)
+{
+    free(mh);
+}
+
+
+/*
+ * Looks up the entries for the moves that led to the position. A null
+ * move leaves no context.
+ *
+ * name: get_move_context
+ * @param	mh - the tables
+ * @param	pos - the position
+ * @param	ctx - populated with the entries
+ * @return
+ *
+ */
+void get_move_context(struct move_history *mh, const struct position *pos, struct move_context *ctx)
+{
+    ctx->counter_move = NULL;
+    ctx->continuation[0] = NULL;
+    ctx->continuation[1] = NULL;
+
+    mv_bitmap prev_move = get_earlier_move(pos, 1);
+    if (prev_move == NO_MOVE) {
+        return;
+    }
+
+    // the piece has just moved, so it's on the 'to' square
+    enum square prev_to = TOSQ(prev_move);
+    enum piece prev_pce = get_piece_on_square(pos, prev_to);
+    ctx->counter_move = &mh->counter_moves[prev_pce][prev_to];
+    ctx->continuation[0] = &mh->continuation[0][prev_pce][prev_to];
+
+    mv_bitmap move_before = get_earlier_move(pos, 2);
+    if (move_before == NO_MOVE) {
+        return;
+    }
+
+    // the piece may since have been captured by the previous move (or
+    // taken en passant, leaving the square empty)
+    enum square before_to = TOSQ(move_before);
+    enum piece before_pce;
+    if (IS_CAPTURE_MOVE(prev_move) && prev_to == before_to) {
+        before_pce = (enum piece)CAPTURED_PCE(prev_move);
+    } else {
+        before_pce = get_piece_on_square(pos, before_to);
+    }
+    if (before_pce != NO_PIECE) {
+        ctx->continuation[1] = &mh->continuation[1][before_pce][before_to];
+    }
+}
+
+
+/*
+ * Adds the counter move and history scores to the quiet moves. Moves
+ * that already have a score (eg, killers) are left as they are.
+ *
+ * name: score_quiet_moves
+ * @param	mh - the tables
+ * @param	ctx - the entries for the moves leading to the position
+ * @param	pos - the position
+ * @param	mvl - the moves
+ * @return
+ *
+ */
+void score_quiet_moves(const struct move_history *mh, const struct move_context *ctx,
+                       const struct position *pos, struct move_list *mvl)
+{
+    mv_bitmap counter_move = (ctx->counter_move != NULL) ? get_move(*ctx->counter_move) : NO_MOVE;
+
+    for(uint16_t i = 0; i < mvl->move_count; i++) {
+        mv_bitmap mv = mvl->moves[i];
+        if (is_history_move(mv) == false || get_score(mv) > 0) {
+            continue;
+        }
+
+        if (get_move(mv) == counter_move) {
+            add_to_score(&mvl->moves[i], MOVE_ORDER_WEIGHT_COUNTER_MOVE);
+            continue;
+        }
+
+        enum piece pce = get_piece_on_square(pos, FROMSQ(mv));
+        enum square to_sq = TOSQ(mv);
+
+        int32_t score = mh->history[pce][to_sq];
+        for(uint8_t j = 0; j < NUM_CONTINUATION_PLIES; j++) {
+            if (ctx->continuation[j] != NULL) {
+                score += (*ctx->continuation[j])[pce][to_sq];
+            }
+        }
+
+        // the total is within +/- 3 * HISTORY_MAX
+        add_to_score(&mvl->moves[i], (uint32_t)(MOVE_ORDER_WEIGHT_HISTORY + score));
+    }
+}
+
+
+/*
+ * Updates the tables at the end of a node where a quiet move was best
+ * (either a beta cutoff, or raising alpha). The best move gets a bonus,
+ * and becomes the counter move to the previous move. The other quiet
+ * moves tried get a malus.
+ *
+ * name: update_quiet_history
+ * @param	mh - the tables
+ * @param	ctx - the entries for the moves leading to the position
+ * @param	pos - the position, with the moves taken back
+ * @param	best_move - the best move
+ * @param	quiets_tried - the quiet moves searched at the node, which
+ * 			may include the best move
+ * @param	num_quiets_tried - number of quiet moves searched
+ * @param	depth - the depth of the node
+ * @return
+ *
+ */
+void update_quiet_history(struct move_history *mh, const struct move_context *ctx, const struct position *pos,
+                          mv_bitmap best_move, const mv_bitmap *quiets_tried, uint16_t num_quiets_tried,
+                          uint8_t depth)
+{
+    int32_t bonus = get_bonus(depth);
+    mv_bitmap best = get_move(best_move);
+
+    for(uint16_t i = 0; i <= num_quiets_tried; i++) {
+        // the best move last, since it may not be in the list
+        mv_bitmap mv = (i < num_quiets_tried) ? get_move(quiets_tried[i]) : best;
+        if (i < num_quiets_tried && mv == best) {
+            continue;
+        }
+        int32_t change = (mv == best) ? bonus : -bonus;
+
+        enum piece pce = get_piece_on_square(pos, FROMSQ(mv));
+        enum square to_sq = TOSQ(mv);
+
+        apply_gravity(&mh->history[pce][to_sq], change);
+        for(uint8_t j = 0; j < NUM_CONTINUATION_PLIES; j++) {
+            if (ctx->continuation[j] != NULL) {
+                apply_gravity(&(*ctx->continuation[j])[pce][to_sq], change);
+            }
+        }
+    }
+
+    if (ctx->counter_move != NULL) {
+        *ctx->counter_move = best;
+    }
+}
+
+
+// moves the value towards +/- HISTORY_MAX, by less the nearer it gets
+static inline void apply_gravity(int16_t *entry, int32_t bonus)
+{
+    int32_t abs_bonus = (bonus < 0) ? -bonus : bonus;
+    int32_t value = *entry;
+    value += bonus - value * abs_bonus / HISTORY_MAX;
+    *entry = (int16_t)value;
+}
+
+
+static inline int32_t get_bonus(uint8_t depth)
+{
+    int32_t bonus = HISTORY_BONUS_FACTOR * depth * depth;
+    return (bonus < HISTORY_BONUS_MAX) ? bonus : HISTORY_BONUS_MAX;
+}
@@ -0,0 +1,61 @@
+/*
+ * move_history.h
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "kestrel.h"
+#include "move_gen.h"
+
+// history values are kept within +/- this bound by the gravity update
+#define HISTORY_MAX					16384
+
+// continuation histories for the moves 1 and 2 plies back
+#define NUM_CONTINUATION_PLIES		2
+
+
+// a [piece][to square] table of history values
+typedef int16_t piece_to_history[NUM_PIECES][NUM_SQUARES];
+
+// the quiet move ordering tables for a search thread
+struct move_history {
+    piece_to_history history;
+    mv_bitmap counter_moves[NUM_PIECES][NUM_SQUARES];
+    piece_to_history continuation[NUM_CONTINUATION_PLIES][NUM_PIECES][NUM_SQUARES];
+};
+
+// the entries for the moves leading to a node, looked up once per node
+struct move_context {
+    mv_bitmap *counter_move;		// counter move slot for the previous move, NULL => none
+    piece_to_history *continuation[NUM_CONTINUATION_PLIES];		// NULL => no move that far back
+};
+
+// true for the moves ordered by the history tables, ie, not captures
+static inline bool is_history_move(mv_bitmap mv)
+{
+    return IS_CAPTURE_MOVE(mv) == false && IS_EN_PASS_MOVE(mv) == false;
+}
+
+struct move_history *create_move_history(void);
+void dispose_move_history(struct move_history *mh);
+void get_move_context(struct move_history *mh, const struct position *pos, struct move_context *ctx);
+void score_quiet_moves(const struct move_history *mh, const struct move_context *ctx,
+                       const struct position *pos, struct move_list *mvl);
+void update_quiet_history(struct move_history *mh, const struct move_context *ctx, const struct position *pos,
+                          mv_bitmap best_move, const mv_bitmap *quiets_tried, uint16_t num_quiets_tried,
+                          uint8_t depth);
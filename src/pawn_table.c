@@ -0,0 +1,136 @@
+/*
+ * pawn_table.c
+ *
+ * ---------------------------------------------------------------------
+ * DESCRIPTION: A hashtable of pawn structure evaluations, indexed by
+ * the pawn hash. The pawn structure changes rarely compared to the
+ * rest of the position, so most lookups are hits.
+ *
+ * An all-zero entry is the correct entry for a position with no pawns
+ * (the pawn hash is zero, and there are no pawn terms), so the table
+ * doesn't need any initialisation.
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "kestrel.h"
+#include "pawn_table.h"
+
+
+// each search thread has its own table (see set_thread_pawn_table()),
+// so entries can be updated in place without locking
+static _Thread_local struct pawn_table *thread_pawn_table = NULL;
+static _Thread_local struct pawn_table_stats stats;
+
+
+/*
+ * Allocates a table, with all the entries empty.
+ *
+ * name: create_pawn_table
+ * @param
+ * @return	the table, to be released with dispose_pawn_table()
+ *
+ */
+struct pawn_table *create_pawn_table(void)
+{
+    struct pawn_table *pt = calloc(1, sizeof(struct pawn_table));
+    if (pt == NULL) {
+        printf("unable to allocate pawn table\n");
+        exit(-1);
+    }
+    return pt;
+}
+
+
+void dispose_pawn_table(struct pawn_table *pt)
+{
+    free(pt);
+}
+
+
+void clear_pawn_table(struct pawn_table *pt)
+{
+    memset(pt, 0, sizeof(struct pawn_table));
+}
+
+
+/*
+ * Sets the table used by the calling thread. Without one, nothing is
+ * cached, and the pawn structure is evaluated on every probe.
+ *
+ * name: set_thread_pawn_table
+ * @param	pt - the table, or NULL for none
+ * @return
+ *
+ */
+void set_thread_pawn_table(struct pawn_table *pt)
+{
+    thread_pawn_table = pt;
+}
+
+
+/*
+ * Looks up the entry for the given pawn hash in the calling thread's
+ * table.
+ *
+ * name: probe_pawn_table
+ * @param	pawn_hash - the pawn hash
+ * @param	entry - set to the table slot for the hash, or NULL if the
+ * 			thread has no table
+ * @return	true if the slot holds the entry for the hash. If false, the
+ * 			caller is expected to populate the slot.
+ *
+ */
+bool probe_pawn_table(uint64_t pawn_hash, struct pawn_entry **entry)
+{
+    stats.probes++;
+
+    if (thread_pawn_table == NULL) {
+        *entry = NULL;
+        return false;
+    }
+
+    struct pawn_entry *e = &thread_pawn_table->entries[pawn_hash & (PAWN_TABLE_NUM_ENTRIES - 1)];
+    *entry = e;
+
+    if (e->pawn_hash == pawn_hash) {
+        stats.hits++;
+        return true;
+    }
+    return false;
+}
+
+void prefetch_pawn_table(uint64_t pawn_hash)
+{
+    if (thread_pawn_table != NULL) {
+        __builtin_prefetch(&thread_pawn_table->entries[pawn_hash & (PAWN_TABLE_NUM_ENTRIES - 1)]);
+    }
+}
+
+void get_pawn_table_stats(struct pawn_table_stats *s)
+{
+    *s = stats;
+}
+
+void reset_pawn_table_stats(void)
+{
+    memset(&stats, 0, sizeof(struct pawn_table_stats));
+}
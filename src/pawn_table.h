@@ -0,0 +1,51 @@
+/*
+ * pawn_table.h
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "kestrel.h"
+
+// keep as power of 2
+#define PAWN_TABLE_NUM_ENTRIES		16384
+
+// the cached pawn structure evaluation for a pawn hash
+struct pawn_entry {
+    uint64_t pawn_hash;
+    uint64_t passed_pawns[NUM_COLOURS];		// bitboard of passed pawns
+    uint64_t attack_spans[NUM_COLOURS];		// squares the pawns can ever attack
+    int32_t score;							// >0 for white, <0 for black
+};
+
+// a search thread's table
+struct pawn_table {
+    struct pawn_entry entries[PAWN_TABLE_NUM_ENTRIES];
+};
+
+struct pawn_table_stats {
+    uint64_t probes;
+    uint64_t hits;
+};
+
+struct pawn_table *create_pawn_table(void);
+void dispose_pawn_table(struct pawn_table *pt);
+void clear_pawn_table(struct pawn_table *pt);
+void set_thread_pawn_table(struct pawn_table *pt);
+bool probe_pawn_table(uint64_t pawn_hash, struct pawn_entry **entry);
+void prefetch_pawn_table(uint64_t pawn_hash);
+void get_pawn_table_stats(struct pawn_table_stats *stats);
+void reset_pawn_table_stats(void);
@@ -0,0 +1,174 @@
+/*
+ * root_moves.c
+ *
+ * ---------------------------------------------------------------------
+ * DESCRIPTION: The list of legal moves at the root of the search. It's
+ * built once per search, and kept from one iteration to the next, so
+ * the root moves aren't regenerated and re-scored on every iteration.
+ *
+ * Each move carries its score in the current and previous iterations,
+ * and the number of nodes searched below it. After each root search,
+ * the list is sorted on the scores, so the next search starts with the
+ * best move, followed by the moves that came closest to it. The node
+ * counts tell the time manager how much of the effort is going on the
+ * best move.
+ *
+ * Each search thread has its own list.
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "kestrel.h"
+#include "board.h"
+#include "pieces.h"
+#include "search.h"
+#include "move_gen.h"
+#include "move_gen_utils.h"
+#include "root_moves.h"
+
+
+static inline bool is_ordered_before(const struct root_move *rm1, const struct root_move *rm2);
+
+
+/*
+ * Populates the list with the legal moves in the position, in move
+ * ordering sequence, with the PV move (if any) first.
+ *
+ * name: init_root_moves
+ * @param	pos - the root position
+ * @param	pv_move - the move to search first, or NO_MOVE
+ * @param	rml - populated with the root moves
+ * @return
+ *
+ */
+void init_root_moves(struct position *pos, mv_bitmap pv_move, struct root_move_list *rml)
+{
+    struct move_list mvl = {
+        .moves = {0},
+        .move_count = 0
+    };
+    generate_all_moves(pos, &mvl);
+
+    if (pv_move != NO_MOVE) {
+        for(uint16_t i = 0; i < mvl.move_count; i++) {
+            if (get_move(mvl.moves[i]) == get_move(pv_move)) {
+                add_to_score(&mvl.moves[i], MOVE_ORDER_WEIGHT_PV_MOVE);
+                break;
+            }
+        }
+    }
+
+    rml->count = 0;
+    for(uint16_t i = 0; i < mvl.move_count; i++) {
+        bring_best_move_to_top(i, &mvl);
+
+        mv_bitmap mv = mvl.moves[i];
+        if (make_move(pos, mv) == false) {
+            continue;
+        }
+        take_move(pos);
+
+        struct root_move *rm = &rml->moves[rml->count++];
+        rm->move = get_move(mv);
+        rm->score = -INFINITE;
+        rm->prev_score = -INFINITE;
+        rm->nodes = 0;
+    }
+}
+
+
+/*
+ * Starts a new iteration, keeping the scores from the last one as the
+ * previous scores.
+ *
+ * name: start_root_iteration
+ * @param	rml - the root moves
+ * @return
+ *
+ */
+void start_root_iteration(struct root_move_list *rml)
+{
+    for(uint16_t i = 0; i < rml->count; i++) {
+        rml->moves[i].prev_score = rml->moves[i].score;
+        rml->moves[i].score = -INFINITE;
+    }
+}
+
+
+/*
+ * Sorts the list on the scores, best first. Moves with the same score
+ * (eg, those that failed low) are ordered on their previous scores. The
+ * sort is stable, so otherwise the order from the last sort is kept.
+ *
+ * name: sort_root_moves
+ * @param	rml - the root moves
+ * @return
+ *
+ */
+void sort_root_moves(struct root_move_list *rml)
+{
+    // an insertion sort, since the list is short, and nearly sorted
+    for(uint16_t i = 1; i < rml->count; i++) {
+        struct root_move rm = rml->moves[i];
+        uint16_t j = i;
+        while (j > 0 && is_ordered_before(&rm, &rml->moves[j - 1])) {
+            rml->moves[j] = rml->moves[j - 1];
+            j--;
+        }
+        rml->moves[j] = rm;
+    }
+}
+
+
+/*
+ * Returns the share of the nodes searched below all the root moves
+ * that went on one move.
+ *
+ * name: get_root_node_share
+ * @param	rml - the root moves
+ * @param	mv - the move
+ * @return	the share, between 0 and 1
+ *
+ */
+double get_root_node_share(const struct root_move_list *rml, mv_bitmap mv)
+{
+    uint64_t total = 0;
+    uint64_t move_nodes = 0;
+    for(uint16_t i = 0; i < rml->count; i++) {
+        total += rml->moves[i].nodes;
+        if (rml->moves[i].move == get_move(mv)) {
+            move_nodes = rml->moves[i].nodes;
+        }
+    }
+
+    if (total == 0) {
+        return 0.0;
+    }
+    return (double)move_nodes / (double)total;
+}
+
+
+static inline bool is_ordered_before(const struct root_move *rm1, const struct root_move *rm2)
+{
+    if (rm1->score != rm2->score) {
+        return rm1->score > rm2->score;
+    }
+    return rm1->prev_score > rm2->prev_score;
+}
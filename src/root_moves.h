@@ -0,0 +1,44 @@
+/*
+ * root_moves.h
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "kestrel.h"
+#include "move_gen.h"
+
+
+// a legal move at the root, and what the search has found out about it
+struct root_move {
+    mv_bitmap move;					// the move, without a move ordering score
+    int32_t score;					// score in this iteration, -INFINITE => not searched, or failed low
+    int32_t prev_score;				// score in the previous iteration
+    uint64_t nodes;					// nodes searched below the move, over the whole search
+};
+
+// the root moves of a search thread, in the order they're searched
+struct root_move_list {
+    struct root_move moves[MAX_POSITION_MOVES];
+    uint16_t count;
+};
+
+
+void init_root_moves(struct position *pos, mv_bitmap pv_move, struct root_move_list *rml);
+void start_root_iteration(struct root_move_list *rml);
+void sort_root_moves(struct root_move_list *rml);
+double get_root_node_share(const struct root_move_list *rml, mv_bitmap mv);
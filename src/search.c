@@ -4,6 +4,25 @@
  * ---------------------------------------------------------------------
  * DESCRIPTION : Contains code for searching for moves and determining
  * the best ones
+ *
+ * The search can use several threads ("Lazy SMP"). Every thread runs
+ * its own iterative deepening search on a private copy of the position
+ * (which also holds the killer moves), with its own history tables
+ * (see move_history.c), and the threads
+ * only interact through the shared transposition table. The helper
+ * threads start at staggered depths, so they tend to be searching
+ * different parts of the tree, and fill the TT with results the main
+ * thread can use. When the main thread finishes, the helpers are
+ * stopped, and the deepest result (highest score on a tie) is played.
+ *
+ * Alternatively, the threads can share a single search using "Young
+ * Brothers Wait" (YBWC). Only the main thread runs iterative deepening.
+ * Once the first move at a node has been searched, the remaining moves
+ * can be handed out to idle threads. To do this, the node becomes a
+ * "split point", which is pushed onto a per-thread deque. Idle threads
+ * steal the oldest split points, ie, the ones nearest the root. The
+ * split point holds the shared alpha/beta bounds and the best move. A
+ * beta cutoff at a split point stops every thread working below it.
  * ---------------------------------------------------------------------
  *
  *
@@ -22,12 +41,17 @@
  * You should have received a copy of the GNU General Public License along
  * with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include "kestrel.h"
 #include "search.h"
 #include "attack.h"
@@ -35,21 +59,262 @@
 #include "board.h"
 #include "pieces.h"
 #include "tt.h"
+#include "analysis_cache.h"
 #include "board_utils.h"
 #include "move_gen.h"
 #include "move_gen_utils.h"
 #include "uci_protocol.h"
 #include "utils.h"
+#include "search_timer.h"
+#include "mate_search.h"
+#include "move_history.h"
+#include "root_moves.h"
+#include "pawn_table.h"
+
+
+// max number of nested split points a thread can own
+#define MAX_SPLITS_PER_THREAD	8
+
+// only split nodes with at least this much depth remaining
+#define YBWC_MIN_SPLIT_DEPTH	4
+
+
+// a node being searched by several threads (YBWC)
+struct split_point {
+    pthread_mutex_t lock;
+    struct split_point *parent;		// split point the owner was working on
+    struct position *pos;			// copy of the position at the node
+    struct move_list *mvl;			// the owner's move list
+    uint16_t next_move;				// index of the next move to search
+    uint16_t legal_moves;			// legal moves searched or being searched
+    mv_bitmap *quiets_tried;		// the owner's list of quiet moves tried
+    uint16_t *num_quiets_tried;
+    uint16_t num_workers;			// threads working here, incl. the owner
+    uint8_t depth;
+    uint8_t root_depth;				// nominal depth of the iteration
+    uint8_t path_extensions;		// extensions on the path to the node
+    bool is_pv_node;
+    bool in_check;
+
+    // ---- shared search results
+    int32_t alpha;
+    int32_t beta;
+    mv_bitmap best_move;
+    uint8_t pv_length;				// PV of the best move
+    mv_bitmap pv_line[MAX_SEARCH_DEPTH];
+    bool cutoff;					// set on a beta cutoff
+};
+
+
+// the triangular PV table. Row n holds the PV of the node being searched
+// at ply n, which is built from the move that raised alpha and the PV of
+// the child at ply n + 1, so row 0 ends up with the PV of the root.
+struct pv_table {
+    uint8_t length[MAX_SEARCH_DEPTH + 1];
+    mv_bitmap moves[MAX_SEARCH_DEPTH + 1][MAX_SEARCH_DEPTH];
+};
+
+
+// the state for a single search thread
+struct search_thread {
+    pthread_t thread;
+    uint16_t thread_id;				// 0 => main thread
+    struct position *pos;			// this thread's copy of the position
+    struct search_info *si;			// this thread's search info
+    struct search_info helper_si;	// storage for helper thread search info
+
+    // ---- result of the last completed iteration
+    uint8_t completed_depth;
+    int32_t best_score;
+    mv_bitmap best_move;
+    uint8_t pv_length;
+    mv_bitmap pv_line[MAX_SEARCH_DEPTH];
+
+    // ---- PVs of the nodes being searched
+    struct pv_table pv_table;
+
+    // ---- quiet move ordering
+    struct move_history *move_history;
+
+    // ---- pawn structure evaluations, kept from one search to the next
+    struct pawn_table *pawn_table;
+
+    // ---- the root moves, kept from one iteration to the next
+    struct root_move_list root_moves;
+
+    // ---- YBWC split points owned by this thread, oldest first
+    pthread_mutex_t split_lock;
+    struct split_point *split_points[MAX_SPLITS_PER_THREAD];
+    uint8_t num_split_points;
+};
 
 
 static int32_t quiescence(struct position *pos, struct search_info *si, int32_t alpha, int32_t beta);
-static int32_t alpha_beta(struct position *pos, struct search_info *si, int32_t alpha, int32_t beta, uint8_t depth);
+static int32_t search_root(struct search_thread *st, int32_t alpha, int32_t beta, uint8_t depth);
+static int32_t alpha_beta(struct position *pos, struct search_info *si, int32_t alpha, int32_t beta, uint8_t depth, bool is_pv_node);
+static inline int32_t search_child(struct position *pos, struct search_info *si, int32_t alpha, int32_t beta,
+                                   uint8_t depth, bool is_pv_node, bool is_first_move, uint8_t reduction);
+static void init_reductions(void);
+static inline bool is_reducible_move(const struct position *pos, mv_bitmap mv);
+static inline uint8_t get_reduction(mv_bitmap mv, uint8_t depth, uint16_t move_num,
+                                    bool is_pv_node, bool gives_check);
+static inline uint8_t get_extension(struct search_info *si, mv_bitmap mv, mv_bitmap prev_move,
+                                    bool is_pv_node, bool gives_check, bool is_singular);
+static bool is_singular_move(struct position *pos, struct search_info *si, mv_bitmap tt_move,
+                             int32_t tt_score, uint8_t depth);
+static inline bool is_in_check(const struct position *pos);
+static inline bool is_quiet_move(mv_bitmap mv);
+static inline int32_t score_to_tt(int32_t score, uint8_t ply);
+static inline int32_t score_from_tt(int32_t score, uint8_t ply);
 static void init_search(struct position *pos);
-static inline void check_search_time_limit(struct search_info *sinfo);
-
-
-// keep as power of 2
-#define	EXPIRY_NODE_COUNT	1024
+static void iterative_deepening(struct search_thread *st, uint8_t start_depth);
+static int32_t aspiration_search(struct search_thread *st, uint8_t depth, int32_t prev_score);
+static int32_t search_root_line(struct search_thread *st, uint8_t depth, uint8_t pv_index);
+static void init_root_lines(struct position *pos, struct search_info *si, struct root_move_list *rml);
+static inline bool is_search_move(const struct search_info *si, mv_bitmap mv);
+static inline bool is_earlier_line_move(const struct search_info *si, mv_bitmap mv);
+static uint8_t get_line_pv(const struct search_thread *st, mv_bitmap line_move, mv_bitmap *pv_line);
+static inline void update_pv(struct pv_table *pvt, uint8_t ply, mv_bitmap mv);
+static inline uint8_t get_uci_line_number(const struct search_info *si);
+static void *helper_thread_search(void *arg);
+static void *ybwc_worker_thread(void *arg);
+static bool can_split(uint8_t depth);
+static bool split(struct position *pos, struct search_info *si, struct move_list *mvl, uint16_t next_move,
+                  uint16_t legal_moves, mv_bitmap *quiets_tried, uint16_t *num_quiets_tried,
+                  int32_t *alpha, int32_t beta, uint8_t depth, bool is_pv_node,
+                  bool in_check, mv_bitmap *best_move);
+static void search_split_point(struct split_point *sp, struct position *pos, struct search_info *si);
+static struct split_point *steal_split_point(const struct search_thread *thief);
+static bool is_search_aborted(void);
+static void start_helper_threads(struct position *pos, const struct search_info *si);
+static void reset_search_thread(struct search_thread *st);
+static void stop_helper_threads(void);
+static const struct search_thread *select_best_thread(void);
+static uint64_t get_total_nodes(void);
+static inline bool try_null_move(struct position *pos, struct search_info *si, int32_t beta, uint8_t depth,
+                                 int32_t static_eval);
+static inline bool try_probcut(struct position *pos, struct search_info *si, int32_t beta, uint8_t depth,
+                               int32_t static_eval);
+static inline bool is_prunable_move(struct search_info *si, uint8_t depth, uint16_t move_num,
+                                    int32_t static_eval, int32_t alpha);
+static inline void check_search_stopped(struct search_info *sinfo);
+static inline bool is_pondering(struct search_info *si);
+static bool search_for_mate(struct position *pos, struct search_info *si, uint32_t table_size_in_bytes);
+static void wait_until_move_can_be_sent(struct search_info *si);
+
+
+// how often a finished search checks for "stop" or "ponderhit"
+static const struct timespec wait_for_stop_interval = { .tv_sec = 0, .tv_nsec = 1000000 };
+
+// helper threads start iterative deepening at depth 1 + (id % SMP_DEPTH_STAGGER)
+#define SMP_DEPTH_STAGGER	3
+
+// aspiration windows are used from this depth, starting at +/- ASPIRATION_WINDOW
+// around the previous score. The window doubles on each fail, and is opened
+// fully once it's wider than ASPIRATION_MAX_WINDOW
+#define ASPIRATION_MIN_DEPTH	4
+#define ASPIRATION_WINDOW		60
+#define ASPIRATION_MAX_WINDOW	400
+
+// the root move being searched is only reported once the search has run
+// this long, so short searches don't flood the GUI
+#define CURRMOVE_MIN_TIME_MS	3000
+
+// null move pruning is tried from NULL_MOVE_MIN_DEPTH, with a reduction of
+// NULL_MOVE_R, plus 1 above NULL_MOVE_DEEP_DEPTH ("adaptive" null move).
+// From NULL_MOVE_VERIFY_DEPTH, a null move cutoff is checked with a reduced
+// search of the node itself, to guard against zugzwang
+#define NULL_MOVE_MIN_DEPTH		2
+#define NULL_MOVE_R				2
+#define NULL_MOVE_DEEP_DEPTH	6
+#define NULL_MOVE_VERIFY_DEPTH	8
+
+// late move reductions. Quiet moves from LMR_MIN_MOVES on, at LMR_MIN_DEPTH
+// and deeper, are searched with reduced depth, taken from a table indexed
+// by depth and move number
+#define LMR_MIN_DEPTH			3
+#define LMR_MIN_MOVES			4
+#define LMR_MAX_MOVES			64
+#define LMR_BASE				0.75
+#define LMR_DIVISOR				2.25
+
+// forward pruning at non-PV nodes near the leaves, indexed by depth
+//
+// reverse futility (static null move) : cutoff when static eval - margin
+// is still >= beta
+#define RFP_MAX_DEPTH			6
+#define RFP_MARGIN				85		// per ply
+// razoring : drop into quiescence when static eval + margin < alpha. Only
+// at depth 1, as quiescence can't see mates that a depth 2 search would
+#define RAZOR_MAX_DEPTH			1
+static const int32_t razor_margin[RAZOR_MAX_DEPTH + 1] = {0, 300};
+// futility : skip quiet moves when static eval + margin <= alpha
+#define FUTILITY_MAX_DEPTH		3
+static const int32_t futility_margin[FUTILITY_MAX_DEPTH + 1] = {0, 150, 300, 500};
+// late move pruning : skip quiet moves after this many moves
+#define LMP_MAX_DEPTH			3
+static const uint16_t lmp_move_count[LMP_MAX_DEPTH + 1] = {0, 6, 10, 16};
+// ProbCut : a capture that beats beta + margin in a search PROBCUT_R plies
+// shallower is assumed to beat beta in a full-depth search
+#define PROBCUT_MIN_DEPTH		5
+#define PROBCUT_MARGIN			200
+#define PROBCUT_R				4
+
+// moves aren't pruned at split points, so the move pruning has to stay
+// below the YBWC split depth
+#if FUTILITY_MAX_DEPTH >= YBWC_MIN_SPLIT_DEPTH || LMP_MAX_DEPTH >= YBWC_MIN_SPLIT_DEPTH
+#error "futility/late move pruning depth overlaps the YBWC split depth"
+#endif
+
+// quiescence : captures that can't raise the score to within DELTA_MARGIN
+// of alpha are skipped (delta pruning)
+#define DELTA_MARGIN			200
+
+// extensions. Moves that give check, and recaptures on the PV, are
+// extended by a ply. From SINGULAR_MIN_DEPTH, a TT move that beats every
+// alternative by SINGULAR_MARGIN per ply in a reduced search that
+// excludes it (ie, is "singular") is also extended. The plies of
+// extension on any root-to-leaf path are capped at the nominal depth of
+// the iteration, so a path is at most twice as long as the nominal depth.
+#define SINGULAR_MIN_DEPTH		6
+#define SINGULAR_TT_DEPTH		3		// TT entry can be this much shallower
+#define SINGULAR_MARGIN			2		// per ply
+
+// nodes without a TT move. At PV nodes from IID_MIN_DEPTH, a search
+// IID_R plies shallower finds a move to try first (internal iterative
+// deepening). Other nodes from IIR_MIN_DEPTH are searched a ply
+// shallower instead (internal iterative reduction), since they're
+// unlikely to be ordered well enough to cut off quickly
+#define IID_MIN_DEPTH			5
+#define IID_R					2
+#define IIR_MIN_DEPTH			4
+
+// quiet moves remembered at a node, to be given a history malus when
+// another quiet move turns out best
+#define MAX_QUIETS_TRIED		64
+
+#define IS_MATE_SCORE(score)	((score) > MATE - MAX_SEARCH_DEPTH || (score) < -(MATE - MAX_SEARCH_DEPTH))
+
+
+// reduction, in plies, indexed by [depth][move number]
+static uint8_t reductions[MAX_SEARCH_DEPTH][LMR_MAX_MOVES];
+static bool reductions_initialised = false;
+
+
+static struct search_thread search_threads[MAX_SEARCH_THREADS];
+static uint16_t num_search_threads = 1;
+static enum smp_mode smp_mode = SMP_MODE_LAZY;
+
+// set to stop all the search threads
+static bool abort_search = false;
+
+// number of YBWC worker threads looking for work
+static uint16_t idle_threads = 0;
+
+// the search thread state for the current thread, and the split point
+// it's currently working on (if any)
+static _Thread_local struct search_thread *current_thread = NULL;
+static _Thread_local struct split_point *active_split_point = NULL;
 
 
 void init_search_struct(struct search_info *si)
@@ -61,78 +326,1417 @@ void init_search_struct(struct search_info *si)
 
 
 
-void search_positions(struct position *pos, struct search_info *si, uint32_t tt_size_in_bytes)
-{
+void search_positions(struct position *pos, struct search_info *si, uint32_t tt_size_in_bytes)
+{
+
+    si->search_start_time = get_monotonic_time_in_millis();
+    if (si->search_time_set && is_pondering(si) == false) {
+        // the search is stopped at the maximum time by the timer setting
+        // the stop flag, rather than by the search reading the clock.
+        // When pondering, the clock doesn't start until "ponderhit".
+        start_search_timer(si->time_limits.maximum_ms, &si->stop_search);
+    }
+
+    //assert(ASSERT_BOARD_OK(pos) == true);
+
+    num_search_threads = si->num_threads;
+    if (num_search_threads == 0) {
+        num_search_threads = 1;
+    } else if (num_search_threads > MAX_SEARCH_THREADS) {
+        num_search_threads = MAX_SEARCH_THREADS;
+    }
+    smp_mode = si->smp_mode;
+
+    // every thread checks its own node count, so the limit is shared out
+    // between them. With one thread, the limit is exact.
+    si->thread_node_limit = 0;
+    if (si->node_limit > 0) {
+        si->thread_node_limit = si->node_limit / num_search_threads;
+        if (si->thread_node_limit == 0) {
+            si->thread_node_limit = 1;
+        }
+    }
+
+    if (si->mate_moves > 0 && search_for_mate(pos, si, tt_size_in_bytes)) {
+        return;
+    }
+
+    if (reductions_initialised == false) {
+        init_reductions();
+    }
+
+    create_tt_table(tt_size_in_bytes);
+    new_tt_search();
+
+    struct search_thread *main_thread = &search_threads[0];
+    reset_search_thread(main_thread);
+    main_thread->pos = pos;
+    main_thread->si = si;
+    main_thread->move_history = create_move_history();
+    pthread_mutex_init(&main_thread->split_lock, NULL);
+    current_thread = main_thread;
+    active_split_point = NULL;
+    set_thread_pawn_table(main_thread->pawn_table);
+
+    init_search(pos);
+    init_root_lines(pos, si, &main_thread->root_moves);
+
+    // the helpers take a copy of the position before the main thread
+    // starts changing it
+    start_helper_threads(pos, si);
+
+    iterative_deepening(main_thread, 1);
+
+    wait_until_move_can_be_sent(si);
+    cancel_search_timer();
+    stop_helper_threads();
+    pthread_mutex_destroy(&main_thread->split_lock);
+    dispose_move_history(main_thread->move_history);
+    main_thread->move_history = NULL;
+
+    const struct search_thread *best = select_best_thread();
+    mv_bitmap best_move = best->best_move;
+
+    // the PV is from the thread's last completed iteration
+    uint8_t num_moves = 0;
+    if (best_move != NO_MOVE) {
+        num_moves = best->pv_length;
+        for(uint8_t i = 0; i < num_moves; i++) {
+            set_pvline(pos, i, best->pv_line[i]);
+        }
+    }
+    if (num_moves == 0 && best_move != NO_MOVE) {
+        set_pvline(pos, 0, best_move);
+        num_moves = 1;
+    }
+
+    // populate the best moves
+    for(int i = 0; i < MAX_SEARCH_DEPTH; i++) {
+        if (i < num_moves) {
+            continue;
+        }
+
+        set_pvline(pos, (uint8_t)i, NO_MOVE);
+    }
+
+    si->best_move = best_move;
+    si->num_nodes = get_total_nodes();
+
+    // update search stats
+    uint32_t elapsed_time_in_millis = (uint32_t)(get_monotonic_time_in_millis() - si->search_start_time);
+    if (elapsed_time_in_millis > 0) {
+        si->nodes_per_second = (si->num_nodes * 1000) / elapsed_time_in_millis;
+    }
+
+    // the GUI can ponder on the expected reply
+    mv_bitmap ponder_move = NO_MOVE;
+    if (num_moves > 1) {
+        ponder_move = get_pvline(pos, 1);
+    }
+
+    uci_print_bestmove(best_move, ponder_move);
+}
+
+
+/*
+ * Looks for a mate with the proof-number solver, for "go mate N". If
+ * one is found, it's sent as the best move. Otherwise, the position is
+ * left to alpha-beta, searching no deeper than the mate would be, so
+ * there's still a move to play.
+ *
+ * name: search_for_mate
+ * @param	pos - the position
+ * @param	si - the search info
+ * @param	table_size_in_bytes - size of the mate search table
+ * @return	true if a mate was found (and the best move sent)
+ *
+ */
+static bool search_for_mate(struct position *pos, struct search_info *si, uint32_t table_size_in_bytes)
+{
+    struct mate_search_result mate;
+    if (search_mate(pos, si, si->mate_moves, table_size_in_bytes, &mate) == false || mate.pv_length == 0) {
+        printf("info string no mate in %u found\n", si->mate_moves);
+
+        uint8_t mate_plies = (uint8_t)(2 * si->mate_moves - 1);
+        if (si->depth > mate_plies) {
+            si->depth = mate_plies;
+        }
+        return false;
+    }
+
+    uint64_t elapsed = get_monotonic_time_in_millis() - si->search_start_time;
+    uci_print_info_score(MATE - mate.mate_plies, BOUND_EXACT, mate.mate_plies, 0, si->num_nodes,
+                         elapsed, mate.pv_length, mate.pv_line);
+
+    si->best_move = mate.pv_line[0];
+    if (elapsed > 0) {
+        si->nodes_per_second = (si->num_nodes * 1000) / elapsed;
+    }
+
+    wait_until_move_can_be_sent(si);
+    cancel_search_timer();
+
+    uci_print_bestmove(si->best_move, (mate.pv_length > 1) ? mate.pv_line[1] : NO_MOVE);
+    return true;
+}
+
+
+// the best move can't be sent before "ponderhit" or "stop", even if the
+// search has finished
+static void wait_until_move_can_be_sent(struct search_info *si)
+{
+    while (__atomic_load_n(&si->stop_search, __ATOMIC_RELAXED) == false
+            && (is_pondering(si) || si->infinite)) {
+        nanosleep(&wait_for_stop_interval, NULL);
+    }
+}
+
+
+/*
+ * Switches a pondering search to a normal timed search, on the UCI
+ * "ponderhit" command. The search carries on from where it is, and the
+ * time spent pondering counts towards the time for the move, so if the
+ * time manager had already decided to stop, the search stops now.
+ * Otherwise the deadline timer starts, with the full maximum time.
+ * Called from a thread other than the one searching.
+ *
+ * name: ponder_hit
+ * @param	si - the search info passed to search_positions()
+ * @return
+ *
+ */
+void ponder_hit(struct search_info *si)
+{
+    // the timer is started before the search can see the ponderhit and
+    // finish, so it's always cancelled at the end of the search
+    if (si->search_time_set) {
+        start_search_timer(si->time_limits.maximum_ms, &si->stop_search);
+    }
+
+    __atomic_store_n(&si->ponder, false, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&si->stop_on_ponderhit, __ATOMIC_SEQ_CST)) {
+        request_search_stop(si);
+    }
+}
+
+
+/*
+ * Asks a running search to stop, eg, on the UCI "stop" command. This is
+ * called from a thread other than the one searching; the search sees
+ * the request at the next node it visits.
+ *
+ * name: request_search_stop
+ * @param	si - the search info passed to search_positions()
+ * @return
+ *
+ */
+void request_search_stop(struct search_info *si)
+{
+    __atomic_store_n(&si->stop_search, true, __ATOMIC_RELAXED);
+}
+
+
+/*
+ * Runs the iterative deepening loop for a search thread, recording
+ * the result of each completed iteration in the thread state.
+ *
+ * name: iterative_deepening
+ * @param	st - the search thread
+ * @param	start_depth - the first depth to search
+ * @return
+ *
+ */
+static void iterative_deepening(struct search_thread *st, uint8_t start_depth)
+{
+    struct position *pos = st->pos;
+    struct search_info *si = st->si;
+
+    struct search_progress progress;
+    memset(&progress, 0, sizeof(struct search_progress));
+
+    for(uint8_t current_depth = start_depth; current_depth <= si->depth; current_depth++) {
+        si->root_depth = current_depth;
+        uint64_t iteration_start_time = get_monotonic_time_in_millis();
+        start_root_iteration(&st->root_moves);
+        int32_t score = search_root_line(st, current_depth, 0);
+
+        if (si->search_stopped == true) {
+            break;
+        }
+
+        bool is_first_iteration = (st->completed_depth == 0);
+        bool best_move_changed = get_move(si->best_move) != get_move(st->best_move);
+        int32_t prev_score = st->best_score;
+
+        // the best line on its own is a completed iteration, the other
+        // MultiPV lines are extra
+        st->completed_depth = current_depth;
+        st->best_score = score;
+        st->best_move = si->best_move;
+
+        // for the time manager, before the other lines are searched
+        double best_move_node_share = get_root_node_share(&st->root_moves, st->best_move);
+
+        st->pv_length = get_line_pv(st, st->best_move, st->pv_line);
+
+        if (st->thread_id == 0) {
+            if (si->num_search_moves == 0) {
+                // keep deep results for future runs
+                add_to_analysis_cache(get_board_hash(pos), st->best_move, score_to_tt(score, 0), BOUND_EXACT, current_depth);
+            }
+
+            uci_print_info_score(score, BOUND_EXACT, current_depth, get_uci_line_number(si), get_total_nodes(),
+                                 (get_monotonic_time_in_millis() - si->search_start_time),
+                                 st->pv_length, st->pv_line);
+        }
+
+        for(uint8_t pv_index = 1; pv_index < si->num_lines; pv_index++) {
+            int32_t line_score = search_root_line(st, current_depth, pv_index);
+            if (si->search_stopped == true) {
+                break;
+            }
+
+            if (st->thread_id == 0) {
+                mv_bitmap pv_line[MAX_SEARCH_DEPTH];
+                uint8_t num_moves = get_line_pv(st, si->line_moves[pv_index], pv_line);
+                uci_print_info_score(line_score, BOUND_EXACT, current_depth, get_uci_line_number(si), get_total_nodes(),
+                                     (get_monotonic_time_in_millis() - si->search_start_time),
+                                     num_moves, pv_line);
+            }
+        }
+
+        if (si->search_stopped == true) {
+            break;
+        }
+        if (st->thread_id != 0) {
+            continue;
+        }
+
+        if (si->search_time_set) {
+            uint64_t now = get_monotonic_time_in_millis();
+            progress.depth = current_depth;
+            progress.elapsed_ms = (uint32_t)(now - si->search_start_time);
+            progress.prev_iteration_ms = progress.last_iteration_ms;
+            progress.last_iteration_ms = (uint32_t)(now - iteration_start_time);
+            progress.best_move_changes = progress.best_move_changes / 2;
+            if (is_first_iteration == false && best_move_changed) {
+                progress.best_move_changes += 1.0;
+            }
+            progress.score_drop = is_first_iteration ? 0 : prev_score - score;
+
+            progress.best_move_node_share = best_move_node_share;
+
+            if (should_start_iteration(&si->time_limits, &progress) == false) {
+                if (is_pondering(si) == false) {
+                    break;
+                }
+
+                // keep pondering, but stop as soon as there's a ponderhit.
+                // The ponderhit may have come in since the check above.
+                __atomic_store_n(&si->stop_on_ponderhit, true, __ATOMIC_SEQ_CST);
+                if (is_pondering(si) == false) {
+                    break;
+                }
+            }
+        }
+
+        // stopped while finishing off this iteration
+        if (__atomic_load_n(&si->stop_search, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+}
+
+
+/*
+ * Searches the root position to the given depth. Once the search is
+ * deep enough for the score to be stable, it starts with a narrow window
+ * around the previous iteration's score. If the score falls outside the
+ * window, the window is widened on that side and the search repeated,
+ * until it's wide enough to be opened fully.
+ *
+ * name: aspiration_search
+ * @param	st - the search thread
+ * @param	depth - the search depth
+ * @param	prev_score - the score from the previous iteration
+ * @return	the exact score
+ *
+ */
+static int32_t aspiration_search(struct search_thread *st, uint8_t depth, int32_t prev_score)
+{
+    struct search_info *si = st->si;
+
+    int32_t alpha = -INFINITE;
+    int32_t beta = INFINITE;
+    int32_t delta = ASPIRATION_WINDOW;
+
+    if (depth >= ASPIRATION_MIN_DEPTH && st->completed_depth > 0) {
+        alpha = prev_score - delta;
+        beta = prev_score + delta;
+    }
+
+    while (true) {
+        int32_t score = search_root(st, alpha, beta, depth);
+
+        if (si->search_stopped == true) {
+            return score;
+        }
+
+        enum score_bound bound = BOUND_EXACT;
+        if (score <= alpha && alpha > -INFINITE) {
+            si->aspiration_fail_low++;
+            bound = BOUND_UPPER;
+        } else if (score >= beta && beta < INFINITE) {
+            si->aspiration_fail_high++;
+            bound = BOUND_LOWER;
+        } else {
+            return score;
+        }
+
+        if (st->thread_id == 0) {
+            uci_print_info_score(score, bound, depth, get_uci_line_number(si), get_total_nodes(),
+                                 (get_monotonic_time_in_millis() - si->search_start_time),
+                                 1, &si->best_move);
+        }
+
+        delta *= 2;
+        if (delta > ASPIRATION_MAX_WINDOW) {
+            alpha = -INFINITE;
+            beta = INFINITE;
+        } else if (bound == BOUND_UPPER) {
+            alpha = score - delta;
+        } else {
+            beta = score + delta;
+        }
+    }
+}
+
+
+/*
+ * Searches one of the MultiPV lines. The root moves are restricted to
+ * those that don't start any of the better lines already found in this
+ * iteration, so each line is the best of what's left.
+ *
+ * name: search_root_line
+ * @param	st - the search thread
+ * @param	depth - the search depth
+ * @param	pv_index - the line to search, 0 => the best line
+ * @return	the score of the line
+ *
+ */
+static int32_t search_root_line(struct search_thread *st, uint8_t depth, uint8_t pv_index)
+{
+    struct search_info *si = st->si;
+
+    si->pv_index = pv_index;
+    si->path_extensions = 0;
+    int32_t score = aspiration_search(st, depth, si->line_scores[pv_index]);
+
+    if (si->search_stopped == false) {
+        si->line_moves[pv_index] = si->best_move;
+        si->line_scores[pv_index] = score;
+    }
+    return score;
+}
+
+
+/*
+ * Builds the root move list, restricted to the "searchmoves", and works
+ * out how many MultiPV lines to search, ie, no more than the number of
+ * root moves. If none of the "searchmoves" are legal, they're ignored.
+ *
+ * name: init_root_lines
+ * @param	pos - the root position
+ * @param	si - the search info
+ * @param	rml - populated with the root moves
+ * @return
+ *
+ */
+static void init_root_lines(struct position *pos, struct search_info *si, struct root_move_list *rml)
+{
+    struct tt_entry_info tte;
+    mv_bitmap pv_move = probe_tt_entry(get_board_hash(pos), &tte) ? tte.move : NO_MOVE;
+    init_root_moves(pos, pv_move, rml);
+
+    uint16_t num_searchable = 0;
+    for(uint16_t i = 0; i < rml->count; i++) {
+        if (is_search_move(si, rml->moves[i].move)) {
+            rml->moves[num_searchable++] = rml->moves[i];
+        }
+    }
+
+    if (num_searchable == 0) {
+        si->num_search_moves = 0;
+    } else {
+        rml->count = num_searchable;
+    }
+
+    uint8_t num_lines = (si->multi_pv > 1) ? si->multi_pv : 1;
+    if (num_lines > MAX_MULTI_PV) {
+        num_lines = MAX_MULTI_PV;
+    }
+    if (num_lines > rml->count && rml->count > 0) {
+        num_lines = (uint8_t)rml->count;
+    }
+    si->num_lines = num_lines;
+}
+
+
+// true if the root move is one of the "searchmoves", or there aren't any
+static inline bool is_search_move(const struct search_info *si, mv_bitmap mv)
+{
+    if (si->num_search_moves == 0) {
+        return true;
+    }
+    for(uint16_t i = 0; i < si->num_search_moves; i++) {
+        if (get_move(si->search_moves[i]) == get_move(mv)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// true if the root move starts one of the better MultiPV lines found in
+// this iteration, so it isn't searched again for the current line
+static inline bool is_earlier_line_move(const struct search_info *si, mv_bitmap mv)
+{
+    for(uint8_t line = 0; line < si->pv_index; line++) {
+        if (get_move(si->line_moves[line]) == get_move(mv)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/*
+ * Gets the PV of the line just searched from the root row of the
+ * thread's PV table, falling back to just the first move if the root
+ * search didn't complete a PV (eg, a fail high at the root).
+ *
+ * name: get_line_pv
+ * @param	st - the search thread
+ * @param	line_move - the first move of the line
+ * @param	pv_line - populated with the PV
+ * @return	the number of moves in the PV
+ *
+ */
+static uint8_t get_line_pv(const struct search_thread *st, mv_bitmap line_move, mv_bitmap *pv_line)
+{
+    uint8_t num_moves = st->pv_table.length[0];
+    memcpy(pv_line, st->pv_table.moves[0], num_moves * sizeof(mv_bitmap));
+    if (num_moves == 0 || get_move(pv_line[0]) != get_move(line_move)) {
+        pv_line[0] = line_move;
+        num_moves = 1;
+    }
+    return num_moves;
+}
+
+
+// makes the PV at the ply the move, followed by the PV of the child node
+static inline void update_pv(struct pv_table *pvt, uint8_t ply, mv_bitmap mv)
+{
+    uint8_t child_length = pvt->length[ply + 1];
+    pvt->moves[ply][0] = mv;
+    memcpy(&pvt->moves[ply][1], pvt->moves[ply + 1], child_length * sizeof(mv_bitmap));
+    pvt->length[ply] = (uint8_t)(child_length + 1);
+}
+
+
+// the "multipv" number of the line being searched, 0 => not MultiPV
+static inline uint8_t get_uci_line_number(const struct search_info *si)
+{
+    return (si->num_lines > 1) ? (uint8_t)(si->pv_index + 1) : 0;
+}
+
+
+static void start_helper_threads(struct position *pos, const struct search_info *si)
+{
+    __atomic_store_n(&abort_search, false, __ATOMIC_RELAXED);
+    __atomic_store_n(&idle_threads, 0, __ATOMIC_RELAXED);
+
+    void *(*thread_fn)(void *) = helper_thread_search;
+    if (smp_mode == SMP_MODE_YBWC) {
+        thread_fn = ybwc_worker_thread;
+    }
+
+    for(uint16_t i = 1; i < num_search_threads; i++) {
+        struct search_thread *st = &search_threads[i];
+        reset_search_thread(st);
+
+        st->thread_id = i;
+        st->pos = duplicate_board(pos);
+        st->move_history = create_move_history();
+        st->root_moves = search_threads[0].root_moves;
+
+        // the main thread looks after the clock, the helpers are
+        // just told when to stop
+        st->helper_si = *si;
+        st->helper_si.search_time_set = false;
+        st->si = &st->helper_si;
+        pthread_mutex_init(&st->split_lock, NULL);
+
+        if (pthread_create(&st->thread, NULL, thread_fn, st) != 0) {
+            printf("unable to create search thread %u\n", i);
+            exit(-1);
+        }
+    }
+}
+
+
+/*
+ * Clears a search thread's state for a new search. The pawn table is
+ * kept, and is created the first time the thread is used.
+ *
+ * name: reset_search_thread
+ * @param	st - the search thread
+ * @return
+ *
+ */
+static void reset_search_thread(struct search_thread *st)
+{
+    struct pawn_table *pt = st->pawn_table;
+    memset(st, 0, sizeof(struct search_thread));
+
+    if (pt == NULL) {
+        pt = create_pawn_table();
+    }
+    st->pawn_table = pt;
+}
+
+
+/*
+ * Clears the pawn tables of all the search threads, eg for a new game.
+ * Must not be called while a search is in progress.
+ *
+ * name: clear_search_pawn_tables
+ * @param
+ * @return
+ *
+ */
+void clear_search_pawn_tables(void)
+{
+    for(uint16_t i = 0; i < MAX_SEARCH_THREADS; i++) {
+        if (search_threads[i].pawn_table != NULL) {
+            clear_pawn_table(search_threads[i].pawn_table);
+        }
+    }
+}
+
+
+/*
+ * Releases the pawn tables of all the search threads.
+ *
+ * name: dispose_search_pawn_tables
+ * @param
+ * @return
+ *
+ */
+void dispose_search_pawn_tables(void)
+{
+    for(uint16_t i = 0; i < MAX_SEARCH_THREADS; i++) {
+        dispose_pawn_table(search_threads[i].pawn_table);
+        search_threads[i].pawn_table = NULL;
+    }
+}
+
+
+static void *helper_thread_search(void *arg)
+{
+    struct search_thread *st = (struct search_thread *)arg;
+    current_thread = st;
+    set_thread_pawn_table(st->pawn_table);
+
+    uint8_t start_depth = (uint8_t)(1 + (st->thread_id % SMP_DEPTH_STAGGER));
+    if (start_depth > st->si->depth) {
+        start_depth = st->si->depth;
+    }
+
+    iterative_deepening(st, start_depth);
+    return NULL;
+}
+
+
+static void stop_helper_threads(void)
+{
+    __atomic_store_n(&abort_search, true, __ATOMIC_RELAXED);
+
+    for(uint16_t i = 1; i < num_search_threads; i++) {
+        struct search_thread *st = &search_threads[i];
+        pthread_join(st->thread, NULL);
+        pthread_mutex_destroy(&st->split_lock);
+        free_board(st->pos);
+        st->pos = NULL;
+        dispose_move_history(st->move_history);
+        st->move_history = NULL;
+    }
+}
+
+
+/*
+ * The YBWC worker thread. Waits for a split point with moves left to
+ * search, and helps search it.
+ *
+ * name: ybwc_worker_thread
+ * @param	arg - the search thread
+ * @return
+ *
+ */
+static void *ybwc_worker_thread(void *arg)
+{
+    struct search_thread *st = (struct search_thread *)arg;
+    current_thread = st;
+    set_thread_pawn_table(st->pawn_table);
+
+    __atomic_add_fetch(&idle_threads, 1, __ATOMIC_RELAXED);
+
+    while (__atomic_load_n(&abort_search, __ATOMIC_RELAXED) == false) {
+        struct split_point *sp = steal_split_point(st);
+        if (sp == NULL) {
+            sched_yield();
+            continue;
+        }
+
+        __atomic_sub_fetch(&idle_threads, 1, __ATOMIC_RELAXED);
+
+        clone_board(sp->pos, st->pos);
+        search_split_point(sp, st->pos, st->si);
+        st->si->search_stopped = false;
+
+        pthread_mutex_lock(&sp->lock);
+        __atomic_sub_fetch(&sp->num_workers, 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&sp->lock);
+
+        __atomic_add_fetch(&idle_threads, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+
+// true if the current node can be shared with idle threads
+static inline bool can_split(uint8_t depth)
+{
+    return smp_mode == SMP_MODE_YBWC
+           && depth >= YBWC_MIN_SPLIT_DEPTH
+           && __atomic_load_n(&current_thread->num_split_points, __ATOMIC_RELAXED) < MAX_SPLITS_PER_THREAD
+           && __atomic_load_n(&idle_threads, __ATOMIC_RELAXED) > 0;
+}
+
+
+/*
+ * Turns the current node into a split point, so the remaining moves
+ * are searched by this thread and any idle threads. Returns once all
+ * the threads have finished with the split point.
+ *
+ * name: split
+ * @param	pos - the position at the node
+ * @param	si - the search info
+ * @param	mvl - the move list for the node
+ * @param	next_move - index of the first move still to be searched
+ * @param	legal_moves - the number of legal moves already searched
+ * @param	quiets_tried - the quiet moves tried at the node, added to by
+ * 			all the threads at the split point
+ * @param	num_quiets_tried - the number of quiet moves tried
+ * @param	alpha - the current alpha, updated with the result
+ * @param	beta - beta
+ * @param	depth - the remaining depth
+ * @param	is_pv_node - true if the node is on the PV
+ * @param	in_check - true if the side to move is in check
+ * @param	best_move - the current best move, updated with the result
+ * @return	true if there was a beta cutoff
+ *
+ */
+static bool split(struct position *pos, struct search_info *si, struct move_list *mvl, uint16_t next_move,
+                  uint16_t legal_moves, mv_bitmap *quiets_tried, uint16_t *num_quiets_tried,
+                  int32_t *alpha, int32_t beta, uint8_t depth, bool is_pv_node,
+                  bool in_check, mv_bitmap *best_move)
+{
+    struct search_thread *st = current_thread;
+
+    struct split_point sp = {
+        .parent = active_split_point,
+        .pos = duplicate_board(pos),
+        .mvl = mvl,
+        .next_move = next_move,
+        .legal_moves = legal_moves,
+        .quiets_tried = quiets_tried,
+        .num_quiets_tried = num_quiets_tried,
+        .num_workers = 1,
+        .depth = depth,
+        .root_depth = si->root_depth,
+        .path_extensions = si->path_extensions,
+        .is_pv_node = is_pv_node,
+        .in_check = in_check,
+        .alpha = *alpha,
+        .beta = beta,
+        .best_move = NO_MOVE,
+        .pv_length = 0,
+        .cutoff = false
+    };
+    pthread_mutex_init(&sp.lock, NULL);
+
+    pthread_mutex_lock(&st->split_lock);
+    st->split_points[st->num_split_points] = &sp;
+    __atomic_add_fetch(&st->num_split_points, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&st->split_lock);
+
+    search_split_point(&sp, pos, si);
+
+    // close the split point, then wait for the other threads to finish.
+    // The owner can get here with moves left (eg, after a cutoff further
+    // up the tree), so no-one must be able to join once it's leaving.
+    pthread_mutex_lock(&sp.lock);
+    sp.next_move = mvl->move_count;
+    __atomic_sub_fetch(&sp.num_workers, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&sp.lock);
+
+    while (__atomic_load_n(&sp.num_workers, __ATOMIC_ACQUIRE) > 0) {
+        sched_yield();
+    }
+
+    pthread_mutex_lock(&st->split_lock);
+    __atomic_sub_fetch(&st->num_split_points, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&st->split_lock);
+
+    free_board(sp.pos);
+    pthread_mutex_destroy(&sp.lock);
+
+    // a stop caused by this split point's own cutoff doesn't apply
+    // any further up the tree
+    si->search_stopped = is_search_aborted();
+
+    if (sp.best_move != NO_MOVE && sp.alpha > *alpha) {
+        *alpha = sp.alpha;
+        *best_move = sp.best_move;
+
+        struct pv_table *pvt = &st->pv_table;
+        uint8_t ply = get_ply(pos);
+        memcpy(pvt->moves[ply], sp.pv_line, sp.pv_length * sizeof(mv_bitmap));
+        pvt->length[ply] = sp.pv_length;
+    }
+    return sp.cutoff;
+}
+
+
+/*
+ * Searches the remaining moves at a split point until there are none
+ * left, or the split point is cut off.
+ *
+ * name: search_split_point
+ * @param	sp - the split point
+ * @param	pos - this thread's copy of the position at the split point
+ * @param	si - this thread's search info
+ * @return
+ *
+ */
+static void search_split_point(struct split_point *sp, struct position *pos, struct search_info *si)
+{
+    struct split_point *saved_split_point = active_split_point;
+    active_split_point = sp;
+
+    // this thread may be joining from its own search, so save its path
+    uint8_t saved_root_depth = si->root_depth;
+    uint8_t saved_path_extensions = si->path_extensions;
+    mv_bitmap saved_excluded_move = si->excluded_move;
+    si->root_depth = sp->root_depth;
+    si->path_extensions = sp->path_extensions;
+    si->excluded_move = NO_MOVE;
+
+    mv_bitmap prev_move = get_previous_move(pos);
+
+    while (true) {
+        pthread_mutex_lock(&sp->lock);
+        if (sp->cutoff || sp->next_move >= sp->mvl->move_count) {
+            pthread_mutex_unlock(&sp->lock);
+            break;
+        }
+        bring_best_move_to_top(sp->next_move, sp->mvl);
+        mv_bitmap mv = sp->mvl->moves[sp->next_move++];
+        int32_t alpha = sp->alpha;
+        int32_t beta = sp->beta;
+        pthread_mutex_unlock(&sp->lock);
+
+        si->num_nodes++;
+
+        bool reducible = sp->in_check == false && is_reducible_move(pos, mv);
+
+        if (make_move(pos, mv) == false) {
+            si->invalid_moves_made++;
+            continue;
+        }
+
+        // numbered as in the owner's move loop, which only counts legal
+        // moves, so the reductions match an unsplit search. The quiet
+        // moves go on the owner's list, so they get the history malus
+        // if the node is cut off
+        pthread_mutex_lock(&sp->lock);
+        uint16_t move_num = ++sp->legal_moves;
+        if (is_history_move(mv) && *sp->num_quiets_tried < MAX_QUIETS_TRIED) {
+            sp->quiets_tried[(*sp->num_quiets_tried)++] = mv;
+        }
+        pthread_mutex_unlock(&sp->lock);
+
+        // the TT move is searched first, by the owner, so there are no
+        // singular moves here
+        bool gives_check = is_in_check(pos);
+        uint8_t extension = get_extension(si, mv, prev_move, sp->is_pv_node, gives_check, false);
+
+        uint8_t reduction = 0;
+        if (reducible && extension == 0) {
+            reduction = get_reduction(mv, sp->depth, move_num, sp->is_pv_node, gives_check);
+        }
+
+        // the eldest brother has already been searched by the owner
+        si->path_extensions += extension;
+        int32_t score = search_child(pos, si, alpha, beta, (uint8_t)(sp->depth - 1 + extension),
+                                     sp->is_pv_node, false, reduction);
+        si->path_extensions -= extension;
+        take_move(pos);
+
+        if (si->search_stopped == true) {
+            break;
+        }
+
+        pthread_mutex_lock(&sp->lock);
+        if (score > sp->alpha && sp->cutoff == false) {
+            sp->alpha = score;
+            sp->best_move = mv;
+
+            // the PV is built in this thread's table, and handed to the
+            // owner through the split point
+            struct pv_table *pvt = &current_thread->pv_table;
+            uint8_t ply = get_ply(pos);
+            update_pv(pvt, ply, mv);
+            sp->pv_length = pvt->length[ply];
+            memcpy(sp->pv_line, pvt->moves[ply], sp->pv_length * sizeof(mv_bitmap));
+
+            if (score >= sp->beta) {
+                __atomic_store_n(&sp->cutoff, true, __ATOMIC_RELAXED);
+            }
+        }
+        pthread_mutex_unlock(&sp->lock);
+    }
+
+    si->root_depth = saved_root_depth;
+    si->path_extensions = saved_path_extensions;
+    si->excluded_move = saved_excluded_move;
+    active_split_point = saved_split_point;
+}
+
+
+/*
+ * Looks through the other threads' split points for one with moves left
+ * to search, and joins it. The oldest split points are checked first,
+ * since they have the most work left.
+ *
+ * name: steal_split_point
+ * @param	thief - the thread looking for work
+ * @return	the split point, or NULL if there is no work available
+ *
+ */
+static struct split_point *steal_split_point(const struct search_thread *thief)
+{
+    for(uint16_t i = 0; i < num_search_threads; i++) {
+        struct search_thread *victim = &search_threads[(thief->thread_id + i) % num_search_threads];
+        if (victim == thief || __atomic_load_n(&victim->num_split_points, __ATOMIC_RELAXED) == 0) {
+            continue;
+        }
+
+        pthread_mutex_lock(&victim->split_lock);
+        for(uint8_t j = 0; j < victim->num_split_points; j++) {
+            struct split_point *sp = victim->split_points[j];
+
+            pthread_mutex_lock(&sp->lock);
+            bool has_work = sp->cutoff == false && sp->next_move < sp->mvl->move_count;
+            if (has_work) {
+                __atomic_add_fetch(&sp->num_workers, 1, __ATOMIC_RELAXED);
+            }
+            pthread_mutex_unlock(&sp->lock);
+
+            if (has_work) {
+                pthread_mutex_unlock(&victim->split_lock);
+                return sp;
+            }
+        }
+        pthread_mutex_unlock(&victim->split_lock);
+    }
+    return NULL;
+}
+
+
+// true if the search has been stopped, or there has been a cutoff at
+// any of the split points the current thread is working below
+static bool is_search_aborted(void)
+{
+    if (__atomic_load_n(&abort_search, __ATOMIC_RELAXED)) {
+        return true;
+    }
+    for(const struct split_point *sp = active_split_point; sp != NULL; sp = sp->parent) {
+        if (__atomic_load_n(&sp->cutoff, __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/*
+ * Picks the thread with the deepest completed iteration, using the
+ * score to break ties.
+ *
+ * name: select_best_thread
+ * @param
+ * @return	the selected thread
+ *
+ */
+static const struct search_thread *select_best_thread(void)
+{
+    const struct search_thread *best = &search_threads[0];
+
+    for(uint16_t i = 1; i < num_search_threads; i++) {
+        const struct search_thread *st = &search_threads[i];
+        if (st->best_move == NO_MOVE) {
+            continue;
+        }
+        if (best->best_move == NO_MOVE
+                || st->completed_depth > best->completed_depth
+                || (st->completed_depth == best->completed_depth && st->best_score > best->best_score)) {
+            best = st;
+        }
+    }
+    return best;
+}
+
+
+// sums the node counts of all the search threads. Helper counts are read
+// while the helpers are running, so the total is approximate
+static uint64_t get_total_nodes(void)
+{
+    uint64_t total = 0;
+    for(uint16_t i = 0; i < num_search_threads; i++) {
+        total += __atomic_load_n(&search_threads[i].si->num_nodes, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+
+
+static void init_search(struct position *pos)
+{
+
+    for(int i = 0; i < MAX_SEARCH_DEPTH; i++) {
+        set_pvline(pos, (uint8_t)i, NO_MOVE);
+    }
+
+	init_search_killers(pos);
+
+    set_ply(pos, 0);
+
+}
+
+
+/*
+ * Searches the position after a move, using Principal Variation Search.
+ * The first move is searched with the full window. The remaining moves
+ * are expected to be worse, so they get a cheaper zero-width window
+ * around alpha. If one of them beats alpha at a PV node, it's re-searched
+ * with the full window to get the exact score.
+ *
+ * Late moves can also be searched with reduced depth. If a reduced
+ * search beats alpha, the move is searched again at full depth.
+ *
+ * name: search_child
+ * @param	pos - the position, with the move already made
+ * @param	si - the search info
+ * @param	alpha, beta - the window at the parent node
+ * @param	depth - the depth remaining for the child node
+ * @param	is_pv_node - true if the parent is a PV node
+ * @param	is_first_move - true for the first legal move at the parent
+ * @param	reduction - the depth reduction for the zero-window search
+ * @return	the score from the parent's point of view
+ *
+ */
+static inline int32_t search_child(struct position *pos, struct search_info *si, int32_t alpha, int32_t beta,
+                                   uint8_t depth, bool is_pv_node, bool is_first_move, uint8_t reduction)
+{
+    // note: alpha/beta are swapped, and sign is reversed
+    if (is_first_move) {
+        return -alpha_beta(pos, si, -beta, -alpha, depth, is_pv_node);
+    }
+
+    int32_t score;
+    if (reduction > 0) {
+        si->lmr_reduced++;
+        score = -alpha_beta(pos, si, -alpha - 1, -alpha, (uint8_t)(depth - reduction), false);
+        if (score <= alpha || si->search_stopped == true) {
+            return score;
+        }
+        si->lmr_re_search++;
+    }
+
+    score = -alpha_beta(pos, si, -alpha - 1, -alpha, depth, false);
+
+    if (is_pv_node && score > alpha && score < beta && si->search_stopped == false) {
+        si->pvs_re_search++;
+        score = -alpha_beta(pos, si, -beta, -alpha, depth, true);
+    }
+    return score;
+}
+
+
+/*
+ * Populates the late move reduction table. The reduction grows with
+ * the log of both the depth and the move number.
+ *
+ * name: init_reductions
+ * @param
+ * @return
+ *
+ */
+static void init_reductions(void)
+{
+    for(int d = 1; d < MAX_SEARCH_DEPTH; d++) {
+        for(int m = 1; m < LMR_MAX_MOVES; m++) {
+            double r = LMR_BASE + log((double)d) * log((double)m) / LMR_DIVISOR;
+            reductions[d][m] = (uint8_t)r;
+        }
+    }
+    reductions_initialised = true;
+}
+
+
+// true if the move isn't a capture or a promotion
+static inline bool is_quiet_move(mv_bitmap mv)
+{
+    return IS_CAPTURE_MOVE(mv) == false && IS_EN_PASS_MOVE(mv) == false && PROMOTED_PCE(mv) == NO_PIECE;
+}
+
+
+// true if the move is a candidate for LMR: a quiet move that isn't a killer.
+// Must be called before the move is made.
+static inline bool is_reducible_move(const struct position *pos, mv_bitmap mv)
+{
+    if (is_quiet_move(mv) == false) {
+        return false;
+    }
+
+    uint8_t ply = get_ply(pos);
+    mv_bitmap m = get_move(mv);
+    return get_move(get_search_killer(pos, 0, ply)) != m
+           && get_move(get_search_killer(pos, 1, ply)) != m;
+}
+
+
+/*
+ * Returns the LMR depth reduction for a reducible move. Reduces less at
+ * PV nodes and for moves with a good history, and not at all for moves
+ * that give check.
+ *
+ * name: get_reduction
+ * @param	mv - the move, including its move ordering score
+ * @param	depth - the remaining depth at the parent
+ * @param	move_num - the move number (1-based) at the parent
+ * @param	is_pv_node - true if the parent is a PV node
+ * @param	gives_check - true if the move gives check
+ * @return	the reduction, in plies
+ *
+ */
+static inline uint8_t get_reduction(mv_bitmap mv, uint8_t depth, uint16_t move_num,
+                                    bool is_pv_node, bool gives_check)
+{
+    if (depth < LMR_MIN_DEPTH || move_num < LMR_MIN_MOVES || gives_check) {
+        return 0;
+    }
+
+    if (move_num >= LMR_MAX_MOVES) {
+        move_num = LMR_MAX_MOVES - 1;
+    }
+    int32_t r = reductions[depth][move_num];
+
+    if (is_pv_node) {
+        r--;
+    }
+    if (get_score(mv) > MOVE_ORDER_WEIGHT_HISTORY) {
+        // a good history score (or the TT or counter move)
+        r--;
+    }
+
+    // always leave at least 1 ply
+    if (r > depth - 2) {
+        r = depth - 2;
+    }
+    return (r > 0) ? (uint8_t)r : 0;
+}
+
+
+/*
+ * Returns the extension for a move, while the path from the root still
+ * has some of its extension budget left.
+ *
+ * name: get_extension
+ * @param	si - the search info
+ * @param	mv - the move
+ * @param	prev_move - the move that led to the parent node
+ * @param	is_pv_node - true if the parent is a PV node
+ * @param	gives_check - true if the move gives check
+ * @param	is_singular - true if the move is singular
+ * @return	the extension, in plies
+ *
+ */
+static inline uint8_t get_extension(struct search_info *si, mv_bitmap mv, mv_bitmap prev_move,
+                                    bool is_pv_node, bool gives_check, bool is_singular)
+{
+    if (si->path_extensions >= si->root_depth) {
+        return 0;
+    }
+
+    if (is_singular) {
+        si->singular_extensions++;
+        return 1;
+    }
+    if (gives_check) {
+        si->check_extensions++;
+        return 1;
+    }
+    if (is_pv_node && prev_move != NO_MOVE && IS_CAPTURE_MOVE(prev_move)
+            && IS_CAPTURE_MOVE(mv) && TOSQ(mv) == TOSQ(prev_move)) {
+        si->recapture_extensions++;
+        return 1;
+    }
+    return 0;
+}
+
+
+/*
+ * Checks whether the TT move is singular, ie, much better than all the
+ * alternatives. The node is searched to a reduced depth with the TT move
+ * excluded, against a window just below the TT score. If every other
+ * move fails low, the TT move is singular.
+ *
+ * name: is_singular_move
+ * @param	pos - the position
+ * @param	si - the search info
+ * @param	tt_move - the TT move
+ * @param	tt_score - the TT score (a lower bound)
+ * @param	depth - the remaining depth
+ * @return	true if the TT move is singular
+ *
+ */
+static bool is_singular_move(struct position *pos, struct search_info *si, mv_bitmap tt_move,
+                             int32_t tt_score, uint8_t depth)
+{
+    int32_t singular_beta = tt_score - SINGULAR_MARGIN * depth;
+
+    mv_bitmap saved_excluded_move = si->excluded_move;
+    uint8_t saved_excluded_ply = si->excluded_ply;
+    si->excluded_move = tt_move;
+    si->excluded_ply = get_ply(pos);
+
+    si->singular_searches++;
+    int32_t score = alpha_beta(pos, si, singular_beta - 1, singular_beta, (uint8_t)((depth - 1) / 2), false);
+
+    si->excluded_move = saved_excluded_move;
+    si->excluded_ply = saved_excluded_ply;
+
+    return si->search_stopped == false && score < singular_beta;
+}
+
+
+// true if the side to move is in check
+static inline bool is_in_check(const struct position *pos)
+{
+    enum colour side_to_move = get_side_to_move(pos);
+    return is_sq_attacked(pos, get_king_square(pos, side_to_move), GET_OPPOSITE_SIDE(side_to_move));
+}
+
+
+/*
+ * Searches the root position, going through the thread's root move list
+ * rather than generating the moves. The root is always a PV node, and
+ * nothing is pruned. Each move's score is recorded when it's the first
+ * move searched or raises alpha, and the nodes below it are added to its
+ * count. At the end, the list is sorted for the next search.
+ *
+ * The root moves aren't shared with the YBWC helpers, since their nodes
+ * couldn't be counted against the moves. The helpers join in from the
+ * nodes below the root.
+ *
+ * name: search_root
+ * @param	st - the search thread
+ * @param	alpha, beta - the window
+ * @param	depth - the search depth
+ * @return	the score, from the side to move's point of view
+ *
+ */
+static int32_t search_root(struct search_thread *st, int32_t alpha, int32_t beta, uint8_t depth)
+{
+    struct position *pos = st->pos;
+    struct search_info *si = st->si;
+    struct root_move_list *rml = &st->root_moves;
+    struct pv_table *pvt = &st->pv_table;
+    pvt->length[0] = 0;
+
+    check_search_stopped(si);
+    if (si->search_stopped == true) {
+        return 0;
+    }
+
+    si->num_nodes++;
+
+    bool in_check = is_in_check(pos);
+    mv_bitmap best_move = NO_MOVE;
+    int32_t old_alpha = alpha;
+
+    struct move_history *mh = st->move_history;
+    struct move_context ctx;
+    get_move_context(mh, pos, &ctx);
+
+    mv_bitmap quiets_tried[MAX_QUIETS_TRIED];
+    uint16_t num_quiets_tried = 0;
+
+    mv_bitmap prev_move = get_previous_move(pos);
+
+    // the better MultiPV lines keep their scores from this iteration
+    for(uint16_t i = 0; i < rml->count; i++) {
+        if (is_earlier_line_move(si, rml->moves[i].move) == false) {
+            rml->moves[i].score = -INFINITE;
+        }
+    }
+
+    uint16_t move_num = 0;
+    for(uint16_t i = 0; i < rml->count; i++) {
+        struct root_move *rm = &rml->moves[i];
+        mv_bitmap mv = rm->move;
+        if (is_earlier_line_move(si, mv)) {
+            continue;
+        }
+
+        si->num_nodes++;
+        check_search_stopped(si);
+        if (si->search_stopped == true) {
+            return 0;
+        }
+
+        bool reducible = in_check == false && is_reducible_move(pos, mv);
+
+        // the moves in the list are all legal
+        make_move(pos, mv);
+        move_num++;
+
+        if (st->thread_id == 0) {
+            uint64_t elapsed = get_monotonic_time_in_millis() - si->search_start_time;
+            if (elapsed >= CURRMOVE_MIN_TIME_MS) {
+                uci_print_info_currmove(depth, mv, (uint16_t)(move_num + si->pv_index));
+            }
+        }
 
-    si->search_start_time = get_time_of_day_in_millis();
+        bool gives_check = is_in_check(pos);
+        uint8_t extension = get_extension(si, mv, prev_move, true, gives_check, false);
 
-    //assert(ASSERT_BOARD_OK(pos) == true);
+        uint8_t reduction = 0;
+        if (reducible && extension == 0) {
+            reduction = get_reduction(mv, depth, move_num, true, gives_check);
+        }
 
-    init_search(pos);
+        if (is_history_move(mv) && num_quiets_tried < MAX_QUIETS_TRIED) {
+            quiets_tried[num_quiets_tried++] = mv;
+        }
 
-    create_tt_table(tt_size_in_bytes);
+        uint64_t nodes_before = si->num_nodes;
+        si->path_extensions += extension;
+        int32_t score = search_child(pos, si, alpha, beta, (uint8_t)(depth - 1 + extension),
+                                     true, move_num == 1, reduction);
+        si->path_extensions -= extension;
+        take_move(pos);
 
-    mv_bitmap best_move = NO_MOVE;
-    int32_t score = 0;
-    uint8_t num_moves = 0;
-    // use iterative deepening
-    for(uint8_t current_depth = 1; current_depth <= si->depth; current_depth++) {
-        score = alpha_beta(pos, si, -INFINITE, INFINITE, current_depth);
+        rm->nodes += si->num_nodes - nodes_before;
 
         if (si->search_stopped == true) {
-            break;
+            // timed out
+            return 0;
         }
-        num_moves = populate_pv_line(pos, current_depth);
 
-        best_move = get_best_pvline(pos);
-
-        uci_print_info_score(score, current_depth, si->num_nodes,
-                             (get_time_of_day_in_millis() - si->search_start_time),
-                             num_moves, &best_move);
-    }
-
-    // populate the best moves
-    for(int i = 0; i < MAX_SEARCH_DEPTH; i++) {
-        if (i < num_moves) {
-            continue;
+        if (move_num == 1 || score > alpha) {
+            rm->score = score;
         }
 
-        set_pvline(pos, (uint8_t)i, NO_MOVE);
-    }
-    // update search stats
-    uint32_t elapsed_time_in_millis = (uint32_t)(get_time_of_day_in_millis() - si->search_start_time);
-    si->nodes_per_second = (si->num_nodes * 1000) / elapsed_time_in_millis;
+        if (score > alpha) {
+            // before the beta test, since mate distance pruning can make
+            // beta the exact score of a mate
+            update_pv(pvt, 0, mv);
 
-    uci_print_bestmove(best_move);
-}
+            // a fail high at the root is still the best move so far
+            si->best_move = mv;
 
+            if (score >= beta) {
+                if (move_num == 1) {
+                    si->fail_high_first++;
+                }
+                si->fail_high++;
 
+                if (IS_CAPTURE_MOVE(mv) == false) {
+                    si->killer_moves++;
+                    shuffle_search_killers(pos, mv);
+                }
+                if (is_history_move(mv)) {
+                    update_quiet_history(mh, &ctx, pos, mv, quiets_tried, num_quiets_tried, depth);
+                }
+                add_to_tt(get_board_hash(pos), mv, score_to_tt(beta, 0), BOUND_LOWER, depth);
 
-static void init_search(struct position *pos)
-{
+                sort_root_moves(rml);
+                return beta;
+            }
+            alpha = score;
+            best_move = mv;
+        }
+    }
 
-    for(int i = 0; i < MAX_SEARCH_DEPTH; i++) {
-        set_pvline(pos, (uint8_t)i, NO_MOVE);
+    if (move_num == 0) {
+        // no legal moves....must be mate or draw
+        si->zero_legal_moves++;
+        if (in_check) {
+            si->mates_detected++;
+            return -MATE;
+        }
+        return 0;
     }
 
-	init_search_history(pos);
+    if (alpha != old_alpha) {
+        if (is_history_move(best_move)) {
+            si->search_history++;
+            update_quiet_history(mh, &ctx, pos, best_move, quiets_tried, num_quiets_tried, depth);
+        }
 
-	init_search_killers(pos);
+        uint64_t board_hash = get_board_hash(pos);
+        add_to_tt(board_hash, best_move, score_to_tt(alpha, 0), BOUND_EXACT, depth);
+        if (si->num_search_moves == 0 && si->pv_index == 0) {
+            // the result for a restricted root isn't the result for the position
+            add_to_analysis_cache(board_hash, best_move, score_to_tt(alpha, 0), BOUND_EXACT, depth);
+        }
 
-    set_ply(pos, 0);
+        si->added_to_tt++;
+    }
 
+    sort_root_moves(rml);
+    return alpha;
 }
 
 
-static int32_t alpha_beta(struct position *pos, struct search_info *si, int32_t alpha, int32_t beta, uint8_t depth)
+static int32_t alpha_beta(struct position *pos, struct search_info *si, int32_t alpha, int32_t beta, uint8_t depth, bool is_pv_node)
 {
+    // the PV is empty until a move raises alpha
+    struct pv_table *pvt = &current_thread->pv_table;
+    pvt->length[get_ply(pos)] = 0;
+
     if(depth <= 0) {
         return quiescence(pos, si, alpha, beta);
     }
 
-    // only check every so many nodes
-    if ((si->num_nodes & (EXPIRY_NODE_COUNT - 1)) == 0) {
-        check_search_time_limit(si);
+    // only a flag check, so it's cheap enough for every node
+    check_search_stopped(si);
+    if (si->search_stopped == true) {
+        return 0;
     }
 
     si->num_nodes++;
@@ -152,6 +1756,72 @@ static int32_t alpha_beta(struct position *pos, struct search_info *si, int32_t
         return evaluate_position(pos);
     }
 
+    // mate distance pruning : no line from here can beat a mate that's
+    // already been found closer to the root. This keeps the extended
+    // lines short once a mate score is in the window.
+    if (get_ply(pos) > 0) {
+        int32_t mated_score = -MATE + get_ply(pos);
+        int32_t mating_score = MATE - get_ply(pos) - 1;
+        if (alpha < mated_score) {
+            alpha = mated_score;
+        }
+        if (beta > mating_score) {
+            beta = mating_score;
+        }
+        if (alpha >= beta) {
+            si->mate_distance_pruned++;
+            return alpha;
+        }
+    }
+
+    bool in_check = is_in_check(pos);
+
+    // the node is being searched without its TT move, to test whether
+    // the TT move is singular
+    bool is_excluded_node = si->excluded_move != NO_MOVE && si->excluded_ply == get_ply(pos);
+
+    // forward pruning, only at non-PV nodes, when not in check, and not
+    // when looking for a mate
+    bool can_prune = is_pv_node == false && in_check == false && is_excluded_node == false
+                     && get_ply(pos) > 0 && IS_MATE_SCORE(beta) == false;
+    int32_t static_eval = 0;
+    if (can_prune) {
+        static_eval = evaluate_position(pos);
+
+        // reverse futility pruning
+        if (depth <= RFP_MAX_DEPTH && static_eval - RFP_MARGIN * depth >= beta) {
+            si->rfp_cutoff++;
+            return beta;
+        }
+
+        // razoring
+        if (depth <= RAZOR_MAX_DEPTH && static_eval + razor_margin[depth] < alpha) {
+            int32_t razor_alpha = alpha - razor_margin[depth];
+            int32_t score = quiescence(pos, si, razor_alpha, razor_alpha + 1);
+            if (si->search_stopped == true) {
+                return 0;
+            }
+            if (score <= razor_alpha) {
+                si->razor_cutoff++;
+                return alpha;
+            }
+        }
+
+        if (try_null_move(pos, si, beta, depth, static_eval)) {
+            return beta;
+        }
+        if (si->search_stopped == true) {
+            return 0;
+        }
+
+        if (try_probcut(pos, si, beta, depth, static_eval)) {
+            return beta;
+        }
+        if (si->search_stopped == true) {
+            return 0;
+        }
+    }
+
     mv_bitmap best_move = NO_MOVE;
     int32_t old_alpha = alpha;
 
@@ -160,14 +1830,54 @@ static int32_t alpha_beta(struct position *pos, struct search_info *si, int32_t
         .move_count = 0
     };
 
+    // check is position already in PV table
+    struct tt_entry_info tte;
+    bool tt_hit = probe_tt_entry(get_board_hash(pos), &tte);
+    mv_bitmap pv_move = tt_hit ? tte.move : NO_MOVE;
+
+    if (pv_move == NO_MOVE && is_excluded_node == false) {
+        if (is_pv_node && depth >= IID_MIN_DEPTH) {
+            // internal iterative deepening
+            si->iid_searches++;
+            alpha_beta(pos, si, alpha, beta, (uint8_t)(depth - IID_R), true);
+            if (si->search_stopped == true) {
+                return 0;
+            }
+            tt_hit = probe_tt_entry(get_board_hash(pos), &tte);
+            pv_move = tt_hit ? tte.move : NO_MOVE;
+            if (pv_move != NO_MOVE) {
+                si->iid_move_found++;
+            }
+        } else if (is_pv_node == false && depth >= IIR_MIN_DEPTH) {
+            // internal iterative reduction
+            si->iir_reduced++;
+            depth--;
+        }
+    }
+
     generate_all_moves(pos, &mvl);
 
-    // check is position already in PV table
-    mv_bitmap pv_move = probe_tt(get_board_hash(pos));
-    if (pv_move != NO_MOVE) {
+    struct move_history *mh = current_thread->move_history;
+    struct move_context ctx;
+    get_move_context(mh, pos, &ctx);
+    score_quiet_moves(mh, &ctx, pos, &mvl);
+
+    mv_bitmap quiets_tried[MAX_QUIETS_TRIED];
+    uint16_t num_quiets_tried = 0;
+
+    if (is_excluded_node) {
+        // drop the excluded move, so it's never handed to a split point
+        for(uint16_t i = 0; i < mvl.move_count; i++) {
+            if (get_move(mvl.moves[i]) == get_move(si->excluded_move)) {
+                mvl.moves[i] = mvl.moves[mvl.move_count - 1];
+                mvl.move_count--;
+                break;
+            }
+        }
+    } else if (pv_move != NO_MOVE) {
         // prioritise
         for(uint16_t i = 0; i < mvl.move_count; i++) {
-            if (mvl.moves[i] == pv_move) {
+            if (get_move(mvl.moves[i]) == get_move(pv_move)) {
                 add_to_score(&mvl.moves[i], MOVE_ORDER_WEIGHT_PV_MOVE);
                 si->move_ordering_pv_move++;
                 break;
@@ -175,22 +1885,95 @@ static int32_t alpha_beta(struct position *pos, struct search_info *si, int32_t
         }
     }
 
+    // singular extension : is the TT move much better than the others?
+    mv_bitmap singular_move = NO_MOVE;
+    if (depth >= SINGULAR_MIN_DEPTH && pv_move != NO_MOVE && is_excluded_node == false
+            && get_ply(pos) > 0 && si->path_extensions < si->root_depth
+            && (tte.bound == BOUND_LOWER || tte.bound == BOUND_EXACT)
+            && tte.depth + SINGULAR_TT_DEPTH >= depth) {
+        int32_t tt_score = score_from_tt(tte.score, get_ply(pos));
+        if (IS_MATE_SCORE(tt_score) == false && is_singular_move(pos, si, pv_move, tt_score, depth)) {
+            singular_move = pv_move;
+        }
+        if (si->search_stopped == true) {
+            return 0;
+        }
+    }
+
+    mv_bitmap prev_move = get_previous_move(pos);
     uint16_t num_moves = mvl.move_count;
 
     uint8_t legal_move_cnt = 0;
     for(uint16_t i = 0; i < num_moves; i++) {
+        if (legal_move_cnt > 0 && can_split(depth)) {
+            // the eldest brother has been searched, so the rest of the
+            // moves can be shared with the idle threads
+            bool cutoff = split(pos, si, &mvl, i, legal_move_cnt, quiets_tried, &num_quiets_tried,
+                                &alpha, beta, depth, is_pv_node, in_check, &best_move);
+            if (si->search_stopped == true) {
+                return 0;
+            }
+            if (cutoff) {
+                si->fail_high++;
+                if (is_excluded_node == false) {
+                    add_to_tt(get_board_hash(pos), best_move, score_to_tt(beta, get_ply(pos)), BOUND_LOWER, depth);
+                }
+                if (IS_CAPTURE_MOVE(best_move) == false) {
+                    si->killer_moves++;
+                    shuffle_search_killers(pos, best_move);
+                }
+                if (is_history_move(best_move)) {
+                    update_quiet_history(mh, &ctx, pos, best_move, quiets_tried, num_quiets_tried, depth);
+                }
+                return beta;
+            }
+            break;
+        }
+
         bring_best_move_to_top(i, &mvl);
 
         // incr search stats
         si->num_nodes++;
 
+        // illegal moves are counted too, and a mated node can go through
+        // all of them (at every IID depth) without entering a child node
+        check_search_stopped(si);
+        if (si->search_stopped == true) {
+            return 0;
+        }
+
         mv_bitmap mv = mvl.moves[i];
+        bool reducible = in_check == false && is_reducible_move(pos, mv);
+        bool prunable = can_prune && legal_move_cnt > 0 && is_quiet_move(mv);
         bool valid_move = make_move(pos, mv);
         if (valid_move) {
             legal_move_cnt++;
 
-            // note: alpha/beta are swapped, and sign is reversed
-            int32_t score = -alpha_beta(pos, si, -beta, -alpha, (uint8_t)(depth - 1));
+            bool gives_check = is_in_check(pos);
+
+            if (prunable && gives_check == false
+                    && is_prunable_move(si, depth, legal_move_cnt, static_eval, alpha)) {
+                // quiet move that doesn't give check, and can't raise alpha
+                take_move(pos);
+                continue;
+            }
+
+            bool is_singular = singular_move != NO_MOVE && get_move(mv) == get_move(singular_move);
+            uint8_t extension = get_extension(si, mv, prev_move, is_pv_node, gives_check, is_singular);
+
+            uint8_t reduction = 0;
+            if (reducible && extension == 0) {
+                reduction = get_reduction(mv, depth, legal_move_cnt, is_pv_node, gives_check);
+            }
+
+            if (is_history_move(mv) && num_quiets_tried < MAX_QUIETS_TRIED) {
+                quiets_tried[num_quiets_tried++] = mv;
+            }
+
+            si->path_extensions += extension;
+            int32_t score = search_child(pos, si, alpha, beta, (uint8_t)(depth - 1 + extension),
+                                         is_pv_node, legal_move_cnt == 1, reduction);
+            si->path_extensions -= extension;
             take_move(pos);
 
             if (si->search_stopped == true) {
@@ -199,6 +1982,10 @@ static int32_t alpha_beta(struct position *pos, struct search_info *si, int32_t
             }
 
             if (score > alpha) {
+                // before the beta test, since mate distance pruning can
+                // make beta the exact score of a mate
+                update_pv(pvt, get_ply(pos), mv);
+
                 if (score >= beta) {
                     if (legal_move_cnt == 1) {
                         si->fail_high_first++;
@@ -211,40 +1998,35 @@ static int32_t alpha_beta(struct position *pos, struct search_info *si, int32_t
                         // shuffle down killers
                         shuffle_search_killers(pos, mv);
                     }
+                    if (is_history_move(mv)) {
+                        update_quiet_history(mh, &ctx, pos, mv, quiets_tried, num_quiets_tried, depth);
+                    }
+
+                    if (is_excluded_node == false) {
+                        add_to_tt(get_board_hash(pos), mv, score_to_tt(beta, get_ply(pos)), BOUND_LOWER, depth);
+                    }
 
                     return beta;
                 }
                 alpha = score;
                 best_move = mv;
-
-
-                // search history....alpha cutoff, no capture
-                if (IS_CAPTURE_MOVE(mv) == false) {
-                    si->search_history++;
-                    enum square from_sq = FROMSQ(best_move);
-                    enum square to_sq = TOSQ(best_move);
-
-                    enum piece pce = get_piece_on_square(pos, from_sq);
-                    add_to_search_history(pos, pce, to_sq, depth);
-				}
-
-
             }
         } else {
             si->invalid_moves_made++;
         }
     }
 
+    if (is_excluded_node) {
+        // the result excludes the TT move, so isn't stored. With no
+        // other legal moves, the TT move is singular
+        return alpha;
+    }
+
     if(legal_move_cnt == 0) {
         si->zero_legal_moves++;
         //printf("***no legal moves left\n");
         // no legal moves....must be mate or draw
-        enum colour side_to_move = get_side_to_move(pos);
-
-        enum square king_sq = get_king_square(pos, side_to_move);
-        enum colour opposite_side = GET_OPPOSITE_SIDE(side_to_move);
-
-        if (is_sq_attacked(pos, king_sq, opposite_side)) {
+        if (in_check) {
             si->mates_detected++;
             return -MATE + get_ply(pos);
         } else {
@@ -254,9 +2036,16 @@ static int32_t alpha_beta(struct position *pos, struct search_info *si, int32_t
     }
 
     if (alpha != old_alpha) {
+        // search history....alpha improved, no capture
+        if (is_history_move(best_move)) {
+            si->search_history++;
+            update_quiet_history(mh, &ctx, pos, best_move, quiets_tried, num_quiets_tried, depth);
+        }
+
         // improved alpha, so add to tt
         uint64_t board_hash = get_board_hash(pos);
-        add_to_tt(board_hash, best_move, depth);
+        add_to_tt(board_hash, best_move, score_to_tt(alpha, get_ply(pos)), BOUND_EXACT, depth);
+        add_to_analysis_cache(board_hash, best_move, score_to_tt(alpha, get_ply(pos)), BOUND_EXACT, depth);
 
         // search stats
         si->added_to_tt++;
@@ -269,28 +2058,57 @@ static int32_t alpha_beta(struct position *pos, struct search_info *si, int32_t
 
 static int32_t quiescence(struct position *pos, struct search_info *si, int32_t alpha, int32_t beta)
 {
-
-    // only check every so many nodes
-    if ((si->num_nodes & (EXPIRY_NODE_COUNT - 1)) == 0) {
-        check_search_time_limit(si);
+    // the PV is empty until a capture raises alpha
+    uint8_t ply = get_ply(pos);
+    struct pv_table *pvt = &current_thread->pv_table;
+    pvt->length[ply] = 0;
+
+    // only a flag check, so it's cheap enough for every node
+    check_search_stopped(si);
+    if (si->search_stopped == true) {
+        return 0;
     }
     si->num_nodes++;
+    si->quiescence_nodes++;
 
     if (is_repetition(pos) || get_fifty_move_counter(pos) > 100) {
         // draw
         return 0;
     }
 
-    if (get_ply(pos) > MAX_SEARCH_DEPTH - 1) {
+    if (ply > MAX_SEARCH_DEPTH - 1) {
         return evaluate_position(pos);
     }
 
+    // any stored result is from a search at least as deep as this one
+    uint64_t board_hash = get_board_hash(pos);
+    mv_bitmap tt_move = NO_MOVE;
+    struct tt_entry_info tte;
+    if (probe_tt_entry(board_hash, &tte)) {
+        tt_move = tte.move;
+        int32_t tt_score = score_from_tt(tte.score, ply);
+
+        if ((tte.bound == BOUND_EXACT)
+                || (tte.bound == BOUND_LOWER && tt_score >= beta)
+                || (tte.bound == BOUND_UPPER && tt_score <= alpha)) {
+            si->quiescence_tt_cutoff++;
+            if (tt_score >= beta) {
+                return beta;
+            }
+            if (tt_score <= alpha) {
+                return alpha;
+            }
+            return tt_score;
+        }
+    }
+
     // stand pat
     int32_t stand_pat_score = evaluate_position(pos);
     if (stand_pat_score >= beta) {
         si->stand_pat_cutoff++;
         return beta;
     }
+    int32_t old_alpha = alpha;
     if (stand_pat_score > alpha) {
         si->stand_pat_improvement++;
         alpha = stand_pat_score;
@@ -307,10 +2125,39 @@ static int32_t quiescence(struct position *pos, struct search_info *si, int32_t
 
     uint16_t num_moves = mvl.move_count;
 
+    if (tt_move != NO_MOVE) {
+        for(uint16_t i = 0; i < num_moves; i++) {
+            if (get_move(mvl.moves[i]) == get_move(tt_move)) {
+                add_to_score(&mvl.moves[i], MOVE_ORDER_WEIGHT_PV_MOVE);
+                break;
+            }
+        }
+    }
+
+    mv_bitmap best_move = NO_MOVE;
     for(uint16_t i = 0; i < num_moves; i++) {
         bring_best_move_to_top(i, &mvl);
 
         mv_bitmap mv = mvl.moves[i];
+
+        if (PROMOTED_PCE(mv) == NO_PIECE) {
+            enum piece captured = (enum piece)CAPTURED_PCE(mv);
+
+            // delta pruning
+            if (stand_pat_score + (int32_t)GET_PIECE_VALUE(captured) + DELTA_MARGIN <= alpha) {
+                si->delta_pruned++;
+                continue;
+            }
+
+            // skip captures that lose material. SEE can't be negative if
+            // the captured piece is worth at least as much as the attacker
+            enum piece attacker = get_piece_on_square(pos, FROMSQ(mv));
+            if (GET_PIECE_VALUE(captured) < GET_PIECE_VALUE(attacker) && see(pos, mv) < 0) {
+                si->see_pruned++;
+                continue;
+            }
+        }
+
         bool valid_move = make_move(pos, mv);
         if (valid_move) {
 
@@ -325,26 +2172,235 @@ static int32_t quiescence(struct position *pos, struct search_info *si, int32_t
 
             if (score > alpha) {
                 if (score >= beta) {
+                    add_to_tt(board_hash, mv, score_to_tt(beta, ply), BOUND_LOWER, 0);
                     return beta;
                 }
 
                 alpha = score;
+                best_move = mv;
+                update_pv(pvt, ply, mv);
             }
         }
     }
+
+    if (num_moves > 0) {
+        // don't bother storing nodes that only stood pat
+        enum score_bound bound = (alpha > old_alpha) ? BOUND_EXACT : BOUND_UPPER;
+        add_to_tt(board_hash, best_move, score_to_tt(alpha, ply), bound, 0);
+    }
     return alpha;
 }
 
 
+// mate scores are stored relative to the position rather than the root
+static inline int32_t score_to_tt(int32_t score, uint8_t ply)
+{
+    if (score > MATE - MAX_SEARCH_DEPTH) {
+        return score + ply;
+    }
+    if (score < -(MATE - MAX_SEARCH_DEPTH)) {
+        return score - ply;
+    }
+    return score;
+}
+
+static inline int32_t score_from_tt(int32_t score, uint8_t ply)
+{
+    if (score > MATE - MAX_SEARCH_DEPTH) {
+        return score - ply;
+    }
+    if (score < -(MATE - MAX_SEARCH_DEPTH)) {
+        return score + ply;
+    }
+    return score;
+}
+
+
+
+/*
+ * Null move pruning. The side to move passes, and the position is searched
+ * with reduced depth. If the opponent still can't get the score below
+ * beta, the real moves are assumed to be good enough for a cutoff as well.
+ *
+ * The null move isn't tried when in check (the caller checks this), after
+ * a null move, or when the side to move only has pawns, where zugzwang
+ * is common. At high depth, a cutoff is confirmed by a reduced search of
+ * the node itself, with null moves disabled for the next few plies.
+ *
+ * name: try_null_move
+ * @param	pos - the position
+ * @param	si - the search info
+ * @param	beta - beta
+ * @param	depth - the remaining depth
+ * @param	static_eval - the static evaluation of the position
+ * @return	true if the node can be cut off
+ *
+ */
+static inline bool try_null_move(struct position *pos, struct search_info *si, int32_t beta, uint8_t depth,
+                                 int32_t static_eval)
+{
+    uint8_t ply = get_ply(pos);
+
+    if (depth < NULL_MOVE_MIN_DEPTH
+            || ply == 0
+            || ply < si->null_move_min_ply
+            || get_previous_move(pos) == NO_MOVE
+            || has_non_pawn_material(pos, get_side_to_move(pos)) == false
+            || static_eval < beta) {
+        return false;
+    }
+
+    uint8_t r = (depth > NULL_MOVE_DEEP_DEPTH) ? NULL_MOVE_R + 1 : NULL_MOVE_R;
+    uint8_t null_depth = (depth > r + 1) ? (uint8_t)(depth - r - 1) : 0;
+
+    si->null_move_tried++;
 
-static inline void check_search_time_limit(struct search_info *sinfo)
+    make_null_move(pos);
+    int32_t score = -alpha_beta(pos, si, -beta, -beta + 1, null_depth, false);
+    take_null_move(pos);
+
+    if (si->search_stopped == true || score < beta) {
+        return false;
+    }
+
+    if (depth >= NULL_MOVE_VERIFY_DEPTH) {
+        // verify with a reduced search, with null moves disabled below here
+        uint8_t saved_min_ply = si->null_move_min_ply;
+        si->null_move_min_ply = (uint8_t)(ply + 3 * (depth - r) / 4);
+
+        int32_t verify_score = alpha_beta(pos, si, beta - 1, beta, (uint8_t)(depth - r), false);
+
+        si->null_move_min_ply = saved_min_ply;
+
+        if (si->search_stopped == true) {
+            return false;
+        }
+        if (verify_score < beta) {
+            si->null_move_verify_fail++;
+            return false;
+        }
+    }
+
+    si->null_move_cutoff++;
+    return true;
+}
+
+
+/*
+ * ProbCut. If a good capture beats beta by a margin in a search
+ * PROBCUT_R plies shallower, a full-depth search is very likely to beat
+ * beta as well. Only captures that SEE says can win the margin on their
+ * own are tried, and each is first checked with a quiescence search.
+ *
+ * name: try_probcut
+ * @param	pos - the position
+ * @param	si - the search info
+ * @param	beta - beta
+ * @param	depth - the remaining depth
+ * @param	static_eval - the static evaluation of the position
+ * @return	true if the node can be cut off
+ *
+ */
+static inline bool try_probcut(struct position *pos, struct search_info *si, int32_t beta, uint8_t depth,
+                               int32_t static_eval)
 {
-    if(sinfo->search_time_set == true) {
-        uint64_t curr_time_of_day = get_time_of_day_in_millis();
-        if (curr_time_of_day >= sinfo->search_expiry_time) {
-            // search timed out
-            sinfo->search_stopped = true;
+    if (depth < PROBCUT_MIN_DEPTH) {
+        return false;
+    }
+
+    int32_t probcut_beta = beta + PROBCUT_MARGIN;
+
+    struct move_list mvl = {
+        .moves = {0},
+        .move_count = 0
+    };
+    generate_all_capture_moves(pos, &mvl);
+
+    for(uint16_t i = 0; i < mvl.move_count; i++) {
+        bring_best_move_to_top(i, &mvl);
+        mv_bitmap mv = mvl.moves[i];
+
+        if (see(pos, mv) < probcut_beta - static_eval) {
+            continue;
+        }
+
+        if (make_move(pos, mv) == false) {
+            continue;
+        }
+
+        si->probcut_tried++;
+
+        // note: alpha/beta are swapped, and sign is reversed
+        int32_t score = -quiescence(pos, si, -probcut_beta, -probcut_beta + 1);
+        if (score >= probcut_beta && si->search_stopped == false) {
+            score = -alpha_beta(pos, si, -probcut_beta, -probcut_beta + 1, (uint8_t)(depth - PROBCUT_R), false);
+        }
+        take_move(pos);
+
+        if (si->search_stopped == true) {
+            return false;
         }
+        if (score >= probcut_beta) {
+            si->probcut_cutoff++;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/*
+ * Futility and late move pruning of a quiet move. The caller checks the
+ * move is quiet, isn't the first move, and doesn't give check.
+ *
+ * name: is_prunable_move
+ * @param	si - the search info, for the counters
+ * @param	depth - the remaining depth
+ * @param	move_num - the move number (1-based)
+ * @param	static_eval - the static evaluation of the position
+ * @param	alpha - alpha
+ * @return	true if the move can be skipped
+ *
+ */
+static inline bool is_prunable_move(struct search_info *si, uint8_t depth, uint16_t move_num,
+                                    int32_t static_eval, int32_t alpha)
+{
+    if (depth <= LMP_MAX_DEPTH && move_num > lmp_move_count[depth]) {
+        si->lmp_pruned++;
+        return true;
+    }
+    if (depth <= FUTILITY_MAX_DEPTH && static_eval + futility_margin[depth] <= alpha) {
+        si->futility_pruned++;
+        return true;
+    }
+    return false;
+}
+
+
+static inline bool is_pondering(struct search_info *si)
+{
+    return __atomic_load_n(&si->ponder, __ATOMIC_SEQ_CST);
+}
+
+
+static inline void check_search_stopped(struct search_info *sinfo)
+{
+    if (is_search_aborted()) {
+        // stopped by another thread
+        sinfo->search_stopped = true;
+        return;
+    }
+
+    // the first iteration is always finished, so there's a move to play
+    if (sinfo->root_depth <= 1) {
+        return;
+    }
+
+    bool out_of_nodes = sinfo->thread_node_limit > 0 && sinfo->num_nodes >= sinfo->thread_node_limit;
+    if (out_of_nodes || __atomic_load_n(&sinfo->stop_search, __ATOMIC_RELAXED)) {
+        // told to stop, or out of time or nodes, so stop the other threads as well
+        sinfo->search_stopped = true;
+        __atomic_store_n(&abort_search, true, __ATOMIC_RELAXED);
     }
 }
 
@@ -373,8 +2429,8 @@ void dump_search_info(struct search_info *si)
 {
     printf("Search Stats :\n");
     printf("\tSearch Depth..............%d\n", si->depth);
-    printf("\t#nodes....................%d\n", si->num_nodes);
-    printf("\t#nodes/sec................%d\n", si->nodes_per_second);
+    printf("\t#nodes....................%ju\n", (uintmax_t)si->num_nodes);
+    printf("\t#nodes/sec................%ju\n", (uintmax_t)si->nodes_per_second);
     printf("\t#add to TT................%d\n", si->added_to_tt);
     printf("\t#invalid moves............%d\n", si->invalid_moves_made);
     printf("\t#zero legal moves.........%d\n", si->zero_legal_moves);
@@ -388,4 +2444,30 @@ void dump_search_info(struct search_info *si)
     printf("\tfhf/fh....................%.2f\n", ((float)si->fail_high_first/(float)si->fail_high));
     printf("\tstand-pat beta cutoff.....%d\n", si->stand_pat_cutoff);
     printf("\tstand-pat improvement.....%d\n", si->stand_pat_improvement);
+    printf("\tPVS re-searches...........%d\n", si->pvs_re_search);
+    printf("\taspiration fail low.......%d\n", si->aspiration_fail_low);
+    printf("\taspiration fail high......%d\n", si->aspiration_fail_high);
+    printf("\tnull move tried...........%d\n", si->null_move_tried);
+    printf("\tnull move cutoff..........%d\n", si->null_move_cutoff);
+    printf("\tnull move verify fail.....%d\n", si->null_move_verify_fail);
+    printf("\tLMR reduced moves.........%d\n", si->lmr_reduced);
+    printf("\tLMR re-searches...........%d\n", si->lmr_re_search);
+    printf("\treverse futility cutoff...%d\n", si->rfp_cutoff);
+    printf("\trazoring cutoff...........%d\n", si->razor_cutoff);
+    printf("\tfutility pruned...........%d\n", si->futility_pruned);
+    printf("\tlate move pruned..........%d\n", si->lmp_pruned);
+    printf("\tProbCut tried.............%d\n", si->probcut_tried);
+    printf("\tProbCut cutoff............%d\n", si->probcut_cutoff);
+    printf("\tquiescence nodes..........%ju\n", (uintmax_t)si->quiescence_nodes);
+    printf("\tquiescence TT cutoff......%d\n", si->quiescence_tt_cutoff);
+    printf("\tdelta pruned..............%d\n", si->delta_pruned);
+    printf("\tSEE pruned................%d\n", si->see_pruned);
+    printf("\tIID searches..............%d\n", si->iid_searches);
+    printf("\tIID move found............%d\n", si->iid_move_found);
+    printf("\tIIR reduced nodes.........%d\n", si->iir_reduced);
+    printf("\tmate distance pruned......%d\n", si->mate_distance_pruned);
+    printf("\tcheck extensions..........%d\n", si->check_extensions);
+    printf("\trecapture extensions......%d\n", si->recapture_extensions);
+    printf("\tsingular searches.........%d\n", si->singular_searches);
+    printf("\tsingular extensions.......%d\n", si->singular_extensions);
 }
@@ -21,25 +21,58 @@
 #include <stdbool.h>
 #include "kestrel.h"
 #include "move_gen.h"
+#include "time_manager.h"
+
+
+// maximum number of search threads (see the UCI "Threads" option)
+#define MAX_SEARCH_THREADS		128
+
+// maximum number of lines searched (see the UCI "MultiPV" option)
+#define MAX_MULTI_PV			32
+
+// how the search threads share the work (see the UCI "SMPMode" option)
+enum smp_mode {
+    SMP_MODE_LAZY	= 0,		// shared hash table, independent searches
+    SMP_MODE_YBWC	= 1			// young brothers wait, split points
+};
 
 
 struct search_info {
     // ---- inputs to search
     uint8_t depth;					// search depth
-    uint32_t search_time_limit_ms;	// search time in milliseconds
-    bool search_time_set;			// true => search time is set
+    uint16_t num_threads;			// number of search threads (0 => 1)
+    enum smp_mode smp_mode;			// how the threads share the work
+    struct time_limits time_limits;	// search time limits (see calc_time_limits())
+    bool search_time_set;			// true => time_limits is set
+    bool ponder;					// true => pondering, cleared on "ponderhit" (see ponder_hit())
+    bool infinite;					// true => search until told to stop
+    uint64_t node_limit;			// stop after searching this many nodes ("go nodes"), 0 => no limit
+    uint8_t mate_moves;				// look for a mate in this many moves ("go mate"), 0 => normal search
+    uint8_t multi_pv;				// number of best lines to search for (0 => 1)
+    uint16_t num_search_moves;		// root moves to search ("searchmoves"), 0 => all moves
+    mv_bitmap search_moves[MAX_POSITION_MOVES];
 
     // ---- runtime info
-    bool stop_search;				// set to TRUE to stop searching
-    uint64_t search_expiry_time;	// time of day in millis when search expires
-    uint64_t search_start_time;		// time when search starts
+    bool stop_search;				// set by another thread, or the search timer, to stop searching
+    uint64_t search_start_time;		// monotonic time in millis when search starts
     bool search_stopped;			// set when search has stopped/expired
-    bool exit;						// exit kestrel
+    bool stop_on_ponderhit;			// set when the time for the move ran out while pondering
+    mv_bitmap best_move;			// best root move from the last completed iteration
+    uint8_t null_move_min_ply;		// null moves are only tried from this ply on
+    uint8_t root_depth;				// nominal depth of the current iteration
+    uint8_t path_extensions;		// plies of extension on the path from the root
+    mv_bitmap excluded_move;		// move skipped by a singular extension search...
+    uint8_t excluded_ply;			// ...at this ply
+    uint64_t thread_node_limit;		// this thread's share of node_limit, 0 => no limit
+    uint8_t num_lines;				// MultiPV lines to search, no more than there are root moves
+    uint8_t pv_index;				// MultiPV line being searched
+    mv_bitmap line_moves[MAX_MULTI_PV];	// first move of each line, this iteration's before pv_index
+    int32_t line_scores[MAX_MULTI_PV];	// score of each line, likewise
 
 
     // ---- search stats
-    uint32_t num_nodes;				// num nodes searched
-    uint32_t nodes_per_second;		// search performance
+    uint64_t num_nodes;				// num nodes searched
+    uint64_t nodes_per_second;		// search performance
     uint32_t added_to_tt;			// num moves added to transposition table
     uint32_t invalid_moves_made;	// num moves that needed to be reverted
     uint32_t zero_legal_moves;		// num times we hit zero legal moves
@@ -54,11 +87,41 @@ struct search_info {
     uint32_t stand_pat_cutoff;		// num times stand pat is better than beta in Quiescence
     uint32_t stand_pat_improvement;	// num times stand pat improves alpha
     uint32_t mates_detected;		// num mate moves detected
+    uint32_t pvs_re_search;			// num zero-window searches that needed a re-search
+    uint32_t aspiration_fail_low;	// num root searches that failed low
+    uint32_t aspiration_fail_high;	// num root searches that failed high
+    uint32_t null_move_tried;		// num null move searches
+    uint32_t null_move_cutoff;		// num null move beta cutoffs
+    uint32_t null_move_verify_fail;	// num null move cutoffs refuted by verification
+    uint32_t lmr_reduced;			// num moves searched with reduced depth
+    uint32_t lmr_re_search;			// num reduced moves re-searched at full depth
+    uint32_t rfp_cutoff;			// num reverse futility (static null move) cutoffs
+    uint32_t razor_cutoff;			// num razoring cutoffs
+    uint32_t futility_pruned;		// num quiet moves skipped by futility pruning
+    uint32_t lmp_pruned;			// num quiet moves skipped by late move pruning
+    uint32_t probcut_tried;			// num ProbCut capture searches
+    uint32_t probcut_cutoff;		// num ProbCut cutoffs
+    uint64_t quiescence_nodes;		// num nodes searched in quiescence
+    uint32_t quiescence_tt_cutoff;	// num quiescence nodes resolved by the TT
+    uint32_t delta_pruned;			// num captures skipped by delta pruning
+    uint32_t see_pruned;			// num losing captures skipped in quiescence
+    uint32_t iid_searches;			// num internal iterative deepening searches
+    uint32_t iid_move_found;		// num IID searches that found a move to try first
+    uint32_t iir_reduced;			// num nodes reduced for having no TT move
+    uint32_t mate_distance_pruned;	// num nodes cut off by mate distance pruning
+    uint32_t check_extensions;		// num moves extended for giving check
+    uint32_t recapture_extensions;	// num PV recaptures extended
+    uint32_t singular_searches;		// num singular extension exclusion searches
+    uint32_t singular_extensions;	// num TT moves extended as singular
 
 };
 
 void init_search_struct(struct search_info *si);
 void search_positions(struct position *pos, struct search_info *si, uint32_t tt_size_in_bytes);
+void request_search_stop(struct search_info *si);
+void ponder_hit(struct search_info *si);
 void bring_best_move_to_top(uint16_t move_num, struct move_list *mvl);
 void dump_search_info(struct search_info *si);
+void clear_search_pawn_tables(void);
+void dispose_search_pawn_tables(void);
 
@@ -0,0 +1,153 @@
+/*
+ * search_timer.c
+ *
+ * ---------------------------------------------------------------------
+ * DESCRIPTION: A deadline timer for the search. A thread sleeps on the
+ * monotonic clock until the deadline, then sets the search's stop flag,
+ * so the search itself only has to check a flag rather than read the
+ * clock. Cancelling the timer wakes the thread straight away.
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "search_timer.h"
+
+
+static void *timer_thread_main(void *arg);
+static void cancel_timer_thread(void);
+static void init_timer_cond(void);
+
+
+// serialises starting and cancelling the timer, which can happen on
+// both the UCI and search threads (eg, on "ponderhit")
+static pthread_mutex_t control_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t timer_thread;
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond;
+static pthread_once_t timer_cond_once = PTHREAD_ONCE_INIT;
+
+static bool timer_running = false;
+static bool timer_cancelled = false;
+static struct timespec timer_deadline;
+static bool *timer_stop_flag = NULL;
+
+
+/*
+ * Starts the timer. Any timer that's already running is cancelled.
+ *
+ * name: start_search_timer
+ * @param	time_ms - time from now to the deadline
+ * @param	stop_flag - set (atomically) at the deadline
+ * @return
+ *
+ */
+void start_search_timer(uint32_t time_ms, bool *stop_flag)
+{
+    pthread_mutex_lock(&control_lock);
+
+    cancel_timer_thread();
+    pthread_once(&timer_cond_once, init_timer_cond);
+
+    clock_gettime(CLOCK_MONOTONIC, &timer_deadline);
+    timer_deadline.tv_sec += time_ms / 1000;
+    timer_deadline.tv_nsec += (long)(time_ms % 1000) * 1000000;
+    if (timer_deadline.tv_nsec >= 1000000000) {
+        timer_deadline.tv_sec++;
+        timer_deadline.tv_nsec -= 1000000000;
+    }
+
+    timer_stop_flag = stop_flag;
+    timer_cancelled = false;
+
+    if (pthread_create(&timer_thread, NULL, timer_thread_main, NULL) != 0) {
+        printf("unable to create search timer thread\n");
+        exit(-1);
+    }
+    timer_running = true;
+
+    pthread_mutex_unlock(&control_lock);
+}
+
+
+/*
+ * Stops the timer (if it's running) without setting the stop flag, and
+ * waits for the timer thread to finish.
+ *
+ * name: cancel_search_timer
+ * @param
+ * @return
+ *
+ */
+void cancel_search_timer(void)
+{
+    pthread_mutex_lock(&control_lock);
+    cancel_timer_thread();
+    pthread_mutex_unlock(&control_lock);
+}
+
+
+static void cancel_timer_thread(void)
+{
+    if (timer_running == false) {
+        return;
+    }
+
+    pthread_mutex_lock(&timer_lock);
+    timer_cancelled = true;
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_lock);
+
+    pthread_join(timer_thread, NULL);
+    timer_running = false;
+}
+
+
+static void *timer_thread_main(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&timer_lock);
+    while (timer_cancelled == false) {
+        if (pthread_cond_timedwait(&timer_cond, &timer_lock, &timer_deadline) == ETIMEDOUT) {
+            __atomic_store_n(timer_stop_flag, true, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&timer_lock);
+
+    return NULL;
+}
+
+
+// the deadline is on the monotonic clock, rather than the default
+// (time of day) clock
+static void init_timer_cond(void)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
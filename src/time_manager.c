@@ -0,0 +1,235 @@
+/*
+ * time_manager.c
+ *
+ * ---------------------------------------------------------------------
+ * DESCRIPTION: Works out how long to search for. The clock gives an
+ * optimum time for the move, and a maximum time at which the search is
+ * always stopped. Between iterations, the optimum is scaled up when the
+ * best move is unstable or the score is falling, and down when most of
+ * the effort is going on the best move. An iteration is only started if
+ * it's expected to finish in time, since the result of an unfinished
+ * iteration is thrown away.
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "time_manager.h"
+
+
+// moves assumed to be left in the game when there's no "movestogo".
+// With "movestogo", the time is planned over MOVES_TO_GO_RESERVE extra
+// moves, so the clock isn't run down to nothing before the time control
+#define SUDDEN_DEATH_MOVES		30
+#define MAX_MOVES_TO_GO			50
+#define MOVES_TO_GO_RESERVE		1
+
+// share of the increment added to the optimum time
+#define INCREMENT_SHARE_PCT		75
+
+// the maximum time is a multiple of the optimum, but never more than a
+// share of the clock
+#define MAX_TIME_RATIO			4
+#define MAX_CLOCK_SHARE_PCT		50
+
+// optimum time scaling : each recent best move change adds
+// INSTABILITY_FACTOR, and a score drop adds up to
+// SCORE_DROP_MAX / SCORE_DROP_DIVISOR
+#define INSTABILITY_FACTOR		0.4
+#define SCORE_DROP_MAX			120
+#define SCORE_DROP_DIVISOR		200.0
+// above half, each extra share of the root nodes spent on the best move
+// takes away NODE_SHARE_FACTOR of the time
+#define NODE_SHARE_FACTOR		0.8
+
+// an iteration can run on past the scaled optimum by this much
+#define OPTIMUM_OVERRUN_PCT		25
+
+// the next iteration takes this many times as long as the last one,
+// going by the last two iterations
+#define DEFAULT_BRANCHING		2.0
+#define MIN_BRANCHING			1.5
+#define MAX_BRANCHING			4.0
+
+
+static uint32_t reserve_overhead(uint32_t time_ms);
+
+
+/*
+ * Works out the optimum and maximum search times from the clock.
+ *
+ * name: calc_time_limits
+ * @param	tc - the time control
+ * @param	limits - populated with the search time limits
+ * @return	true if the search is limited by time, false otherwise
+ *
+ */
+bool calc_time_limits(const struct time_control *tc, struct time_limits *limits)
+{
+    if (tc->move_time >= 0) {
+        uint32_t move_time = reserve_overhead((uint32_t)tc->move_time);
+        limits->optimum_ms = move_time;
+        limits->maximum_ms = move_time;
+        limits->fixed = true;
+        return true;
+    }
+
+    if (tc->time_left < 0) {
+        // eg, a depth-limited or infinite search
+        return false;
+    }
+
+    uint64_t available = reserve_overhead((uint32_t)tc->time_left);
+
+    uint32_t moves_to_go = SUDDEN_DEATH_MOVES;
+    if (tc->moves_to_go > 0) {
+        moves_to_go = (tc->moves_to_go < MAX_MOVES_TO_GO) ? (uint32_t)tc->moves_to_go : MAX_MOVES_TO_GO;
+        moves_to_go += MOVES_TO_GO_RESERVE;
+    }
+
+    uint64_t increment = (tc->increment > 0) ? (uint64_t)tc->increment : 0;
+
+    uint64_t optimum = available / moves_to_go + increment * INCREMENT_SHARE_PCT / 100;
+    uint64_t maximum = optimum * MAX_TIME_RATIO;
+
+    // the increment isn't added until after the move, so the maximum
+    // has to come out of the time that's left now
+    uint64_t max_from_clock = available * MAX_CLOCK_SHARE_PCT / 100;
+    if (maximum > max_from_clock) {
+        maximum = max_from_clock;
+    }
+    if (maximum == 0) {
+        maximum = 1;
+    }
+    if (optimum > maximum) {
+        optimum = maximum;
+    }
+
+    limits->optimum_ms = (uint32_t)optimum;
+    limits->maximum_ms = (uint32_t)maximum;
+    limits->fixed = false;
+    return true;
+}
+
+
+/*
+ * Scales the optimum time by how settled the search looks. A fixed
+ * time search isn't scaled.
+ *
+ * name: get_scaled_optimum_time
+ * @param	limits - the search time limits
+ * @param	progress - the state of the search
+ * @return	the scaled optimum time in ms, never more than the maximum
+ *
+ */
+uint32_t get_scaled_optimum_time(const struct time_limits *limits, const struct search_progress *progress)
+{
+    if (limits->fixed) {
+        return limits->optimum_ms;
+    }
+
+    double scale = 1.0;
+
+    // an unstable best move needs more time to settle
+    scale *= 1.0 + INSTABILITY_FACTOR * progress->best_move_changes;
+
+    // so does a falling score
+    if (progress->score_drop > 0) {
+        int32_t drop = (progress->score_drop < SCORE_DROP_MAX) ? progress->score_drop : SCORE_DROP_MAX;
+        scale *= 1.0 + (double)drop / SCORE_DROP_DIVISOR;
+    }
+
+    // most of the nodes going on the best move means the alternatives
+    // are being refuted quickly
+    if (progress->best_move_node_share > 0.5) {
+        scale *= 1.0 - (progress->best_move_node_share - 0.5) * NODE_SHARE_FACTOR;
+    }
+
+    double scaled = (double)limits->optimum_ms * scale;
+    if (scaled >= (double)limits->maximum_ms) {
+        return limits->maximum_ms;
+    }
+    return (uint32_t)scaled;
+}
+
+
+/*
+ * Estimates the time the next iteration will take, from the growth in
+ * time between the last two iterations.
+ *
+ * name: estimate_next_iteration_time
+ * @param	progress - the state of the search
+ * @return	the estimated time in ms
+ *
+ */
+uint32_t estimate_next_iteration_time(const struct search_progress *progress)
+{
+    double branching = DEFAULT_BRANCHING;
+    if (progress->prev_iteration_ms > 0) {
+        branching = (double)progress->last_iteration_ms / (double)progress->prev_iteration_ms;
+        if (branching < MIN_BRANCHING) {
+            branching = MIN_BRANCHING;
+        } else if (branching > MAX_BRANCHING) {
+            branching = MAX_BRANCHING;
+        }
+    }
+    return (uint32_t)((double)progress->last_iteration_ms * branching);
+}
+
+
+/*
+ * Decides whether there is time to search another iteration. The next
+ * iteration has to be expected to finish before the maximum time, and
+ * (unless the search time is fixed) not long after the scaled optimum.
+ *
+ * name: should_start_iteration
+ * @param	limits - the search time limits
+ * @param	progress - the state of the search
+ * @return	true if the next iteration should be started
+ *
+ */
+bool should_start_iteration(const struct time_limits *limits, const struct search_progress *progress)
+{
+    uint64_t limit = limits->maximum_ms;
+
+    if (limits->fixed == false) {
+        uint64_t optimum = get_scaled_optimum_time(limits, progress);
+        if (progress->elapsed_ms >= optimum) {
+            return false;
+        }
+
+        uint64_t overrun_limit = optimum + optimum * OPTIMUM_OVERRUN_PCT / 100;
+        if (overrun_limit < limit) {
+            limit = overrun_limit;
+        }
+    }
+
+    uint64_t expected_finish = (uint64_t)progress->elapsed_ms + estimate_next_iteration_time(progress);
+    return expected_finish <= limit;
+}
+
+
+// takes the move overhead off a search time, leaving at least half of it
+static uint32_t reserve_overhead(uint32_t time_ms)
+{
+    if (time_ms > 2 * MOVE_OVERHEAD_MS) {
+        return time_ms - MOVE_OVERHEAD_MS;
+    }
+    return time_ms / 2;
+}
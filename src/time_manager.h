@@ -0,0 +1,56 @@
+/*
+ * time_manager.h
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// time allowed for the GUI and communication lag on each move
+#define MOVE_OVERHEAD_MS		30
+
+
+// the clock, as given by the "go" command
+struct time_control {
+    int32_t time_left;				// ms left on the clock, -1 => no clock
+    int32_t increment;				// ms added to the clock per move
+    int32_t moves_to_go;			// moves to the next time control, 0 => sudden death
+    int32_t move_time;				// fixed search time in ms, -1 => not set
+};
+
+// how long to search for
+struct time_limits {
+    uint32_t optimum_ms;			// target time for the move
+    uint32_t maximum_ms;			// the search is always stopped here
+    bool fixed;						// true => search for exactly maximum_ms
+};
+
+// the state of the search after each completed iteration
+struct search_progress {
+    uint8_t depth;					// depth of the last completed iteration
+    uint32_t elapsed_ms;			// time since the search started
+    uint32_t last_iteration_ms;		// time taken by the last iteration
+    uint32_t prev_iteration_ms;		// time taken by the iteration before that
+    double best_move_changes;		// best move changes, decaying each iteration
+    int32_t score_drop;				// fall in score from the previous iteration
+    double best_move_node_share;	// share of the root nodes spent on the best move, so far in the search
+};
+
+bool calc_time_limits(const struct time_control *tc, struct time_limits *limits);
+uint32_t get_scaled_optimum_time(const struct time_limits *limits, const struct search_progress *progress);
+uint32_t estimate_next_iteration_time(const struct search_progress *progress);
+bool should_start_iteration(const struct time_limits *limits, const struct search_progress *progress);
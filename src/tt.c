@@ -2,8 +2,15 @@
  * tt.c
  *
  * ---------------------------------------------------------------------
- * DESCRIPTION: Maintains a hashtable of principle variation moves.
- * The hashtable is implemented as an array of linked lists.
+ * DESCRIPTION: Maintains a hashtable of search results (best move,
+ * score, bound and depth), shared by all the search threads. The table
+ * is a flat array of 16-byte entries, indexed by the low bits of the
+ * position hash, with one entry per slot (see tt_entry.h).
+ *
+ * The table memory is mapped directly from the kernel. An all-zero
+ * entry is an empty entry, so the table relies on the kernel providing
+ * zero-filled pages on first touch rather than writing every entry,
+ * and is cleared by handing the pages back to the kernel.
  * ---------------------------------------------------------------------
  *
  * Copyright (C) 2015 Eddie McNally <emcn@gmx.com>
@@ -21,89 +28,211 @@
  * You should have received a copy of the GNU General Public License along
  * with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
 #include "kestrel.h"
 #include "board.h"
 #include "move_gen.h"
 #include "move_gen_utils.h"
 #include "tt.h"
+#include "tt_entry.h"
 
 
 
-static void init_table(void);
 static void set_tt_size(uint32_t size_in_bytes);
 
 
 
-struct tt_entry {
-    uint64_t hashkey;
-    mv_bitmap move;
-    uint32_t score;
-    uint8_t flags;
-    uint8_t depth;
-};
-
+// the table is shared by all the search threads (see tt_entry.h for
+// the entry layout)
 static uint32_t tt_size = 0;
 static struct tt_entry *tt = NULL;
 
+// the table is kept between searches, so entries are stamped with the
+// search that stored them
+static uint8_t tt_generation = 0;
+
+// the requested and allocated table sizes, in bytes
+static uint32_t tt_requested_bytes = 0;
+static size_t tt_allocated_bytes = 0;
+
 
+/*
+ * Creates the transposition table. If a table of the requested size
+ * already exists, it is left as-is (use clear_tt_table() to empty it).
+ *
+ * name: create_tt_table
+ * @param	size_in_bytes - the required table size
+ * @return
+ *
+ */
 void create_tt_table(uint32_t size_in_bytes)
 {
     if (tt != NULL) {
+        if (size_in_bytes == tt_requested_bytes) {
+            return;
+        }
         dispose_tt_table();
     }
 
     set_tt_size(size_in_bytes);
+}
+
+
+/*
+ * Empties the transposition table. The pages are handed back to the
+ * kernel, which maps in zero-filled pages the next time they're touched,
+ * so the cost is proportional to the number of pages actually used
+ * rather than the table size.
+ *
+ * name: clear_tt_table
+ * @param
+ * @return
+ *
+ */
+void clear_tt_table(void)
+{
+    if (tt == NULL) {
+        return;
+    }
+
+    if (madvise(tt, tt_allocated_bytes, MADV_DONTNEED) != 0) {
+        // fall back to zeroing the table ourselves
+        memset(tt, 0, tt_allocated_bytes);
+    }
+}
+
+
 
-    init_table();
+/*
+ * Starts a new search. Entries stored by earlier searches can then be
+ * replaced by any result from this one, so results from earlier moves
+ * in the game don't fill up the table.
+ *
+ * The generation only has 6 bits, so it wraps after 64 searches. An
+ * entry left from 64 searches ago then looks current again, and is
+ * protected by the depth-preferred rule until a deeper result replaces
+ * it.
+ *
+ * name: new_tt_search
+ * @param
+ * @return
+ *
+ */
+void new_tt_search(void)
+{
+    tt_generation = (uint8_t)((tt_generation + 1) & GENERATION_MASK);
 }
 
 
 
-void add_to_tt(const uint64_t board_hash, const mv_bitmap move, uint8_t depth)
+/*
+ * Adds a search result to the table. A slot filled by the current
+ * search is only replaced by a result from a search at least as deep,
+ * and an exact score is only replaced by a bound from a deeper search.
+ * A slot filled by an earlier search is always replaced.
+ *
+ * The score is stored as-is, so mate scores need to be made relative
+ * to the position (rather than the root) by the caller.
+ *
+ * name: add_to_tt
+ * @param	board_hash - the position hash
+ * @param	move - the best move
+ * @param	score - the score
+ * @param	bound - the type of bound the score represents
+ * @param	depth - the search depth
+ * @return
+ *
+ */
+void add_to_tt(const uint64_t board_hash, const mv_bitmap move, int32_t score, enum score_bound bound, uint8_t depth)
 {
     struct tt_entry * entry = &tt[board_hash & tt_size];
 
-    if (entry->move != NO_MOVE) {
+    uint64_t old_data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    if (old_data != 0 && DATA_GENERATION(old_data) == tt_generation) {
         // slot is filled, only add if depth is greater
-        if (entry->depth > depth) {
+        uint8_t old_depth = DATA_DEPTH(old_data);
+        if (old_depth > depth) {
+            return;
+        }
+        if (old_depth == depth && DATA_BOUND(old_data) == BOUND_EXACT && bound != BOUND_EXACT) {
             return;
         }
     }
-    entry->hashkey = board_hash;
-    entry->move = move;
-    entry->depth = depth;
+
+    uint64_t data = pack_tt_data(move, score, bound, depth, tt_generation);
+
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->key, board_hash ^ data, __ATOMIC_RELAXED);
 }
 
 mv_bitmap probe_tt(const uint64_t board_hash)
 {
-    struct tt_entry * entry = &tt[board_hash & tt_size];
+    const struct tt_entry * entry = &tt[board_hash & tt_size];
 
-    if (entry->hashkey == board_hash) {
-        return entry->move;
+    uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    uint64_t key = __atomic_load_n(&entry->key, __ATOMIC_RELAXED);
+
+    if (data != 0 && (key ^ data) == board_hash) {
+        return DATA_MOVE(data);
     }
     return NO_MOVE;
 }
 
-void dispose_tt_table()
+
+/*
+ * Looks up the position in the table.
+ *
+ * name: probe_tt_entry
+ * @param	board_hash - the position hash
+ * @param	info - populated with the stored result
+ * @return	true if the position was found, false otherwise
+ *
+ */
+bool probe_tt_entry(const uint64_t board_hash, struct tt_entry_info *info)
+{
+    const struct tt_entry * entry = &tt[board_hash & tt_size];
+
+    uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    uint64_t key = __atomic_load_n(&entry->key, __ATOMIC_RELAXED);
+
+    if (data == 0 || (key ^ data) != board_hash) {
+        return false;
+    }
+
+    info->move = DATA_MOVE(data);
+    info->score = DATA_SCORE(data);
+    info->bound = DATA_BOUND(data);
+    info->depth = DATA_DEPTH(data);
+    return true;
+}
+
+/*
+ * Issues a prefetch for the TT entry associated with the given hash,
+ * so the entry is (hopefully) in cache by the time it's probed.
+ *
+ * uses gcc built-in function (see https://gcc.gnu.org/onlinedocs/gcc/Other-Builtins.html)
+ */
+void prefetch_tt(const uint64_t board_hash)
 {
     if (tt != NULL) {
-        free(tt);
+        __builtin_prefetch(&tt[board_hash & tt_size]);
     }
 }
 
-static inline void init_table()
+void dispose_tt_table()
 {
-    for(uint32_t i = 0; i < tt_size; i++) {
-        struct tt_entry * entry = &tt[i];
-        entry->hashkey = 0;
-        entry->move = NO_MOVE;
-        entry->score = 0;
-        entry->depth = 0;
-        entry->flags = 0;
+    if (tt != NULL) {
+        munmap(tt, tt_allocated_bytes);
+        tt = NULL;
+        tt_size = 0;
+        tt_requested_bytes = 0;
+        tt_allocated_bytes = 0;
     }
 }
 
@@ -114,6 +243,8 @@ static void set_tt_size(uint32_t size_in_bytes)
         dispose_tt_table();
     }
 
+    tt_requested_bytes = size_in_bytes;
+
     // round down to nearest power of 2
     if (size_in_bytes & (size_in_bytes - 1)) {
         size_in_bytes--;
@@ -124,10 +255,19 @@ static void set_tt_size(uint32_t size_in_bytes)
         size_in_bytes>>=1;
     }
 
+    // always at least one entry, since mmap() rejects a size of zero
     if (size_in_bytes < sizeof(struct tt_entry)) {
-        tt_size = 0;
+        size_in_bytes = sizeof(struct tt_entry);
+    }
+
+    void *mem = mmap(NULL, size_in_bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        printf("unable to allocate transposition table of %u bytes\n", size_in_bytes);
+        exit(-1);
     }
 
+    tt = (struct tt_entry *)mem;
     tt_size = (uint32_t)((size_in_bytes / sizeof(struct tt_entry)) -1);
-    tt = (struct tt_entry *) malloc(size_in_bytes);
+    tt_allocated_bytes = size_in_bytes;
 }
@@ -17,11 +17,31 @@
  */
 #pragma once
 
+#include <stdbool.h>
 #include "kestrel.h"
 
+// the type of bound a stored score represents
+enum score_bound {
+    BOUND_NONE 	= 0,
+    BOUND_UPPER	= 1,		// score <= stored score (fail low)
+    BOUND_LOWER	= 2,		// score >= stored score (fail high)
+    BOUND_EXACT	= 3
+};
+
+struct tt_entry_info {
+    mv_bitmap move;
+    int32_t score;
+    enum score_bound bound;
+    uint8_t depth;
+};
+
 void create_tt_table(uint32_t tt_size_in_bytes);
-void add_to_tt(const uint64_t board_hash, const mv_bitmap move, uint8_t depth);
+void clear_tt_table(void);
+void new_tt_search(void);
+void add_to_tt(const uint64_t board_hash, const mv_bitmap move, int32_t score, enum score_bound bound, uint8_t depth);
 mv_bitmap probe_tt(const uint64_t board_hash);
+bool probe_tt_entry(const uint64_t board_hash, struct tt_entry_info *info);
+void prefetch_tt(const uint64_t board_hash);
 void dispose_tt_table(void);
 
 
@@ -0,0 +1,77 @@
+/*
+ * tt_entry.h
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "kestrel.h"
+#include "tt.h"
+
+
+/*
+ * A packed search result, as held in the transposition table and the
+ * analysis cache. The tables are accessed without locking. Each entry
+ * holds the packed data and (hash XOR data), so an entry that is torn
+ * by two writers at the same time fails the hash check on reading and
+ * is treated as a miss.
+ */
+struct tt_entry {
+    uint64_t key;					// board hash XOR data
+    uint64_t data;					// packed entry data (see below)
+};
+
+/*
+ * The 'data' field is bitmapped as follows:
+ * bits  0-23 -> move (bits 32-55 of the mv_bitmap, ie, excluding the score)
+ * bits 24-39 -> score (int16)
+ * bits 40-47 -> depth
+ * bits 48-49 -> bound
+ * bits 50-55 -> generation, ie, the search that stored the entry (TT only)
+ *
+ * An all-zero 'data' field is an empty entry.
+ */
+#define DATA_OFF_SCORE		24
+#define DATA_OFF_DEPTH		40
+#define DATA_OFF_BOUND		48
+#define DATA_OFF_GENERATION	50
+
+#define GENERATION_MASK		0x3F
+
+#define DATA_MOVE(d)		((mv_bitmap)((d) & 0xFFFFFF) << MV_MASK_OFF_FROM_SQ)
+#define DATA_SCORE(d)		((int32_t)(int16_t)(((d) >> DATA_OFF_SCORE) & 0xFFFF))
+#define DATA_DEPTH(d)		((uint8_t)(((d) >> DATA_OFF_DEPTH) & 0xFF))
+#define DATA_BOUND(d)		((enum score_bound)(((d) >> DATA_OFF_BOUND) & 0x3))
+#define DATA_GENERATION(d)	((uint8_t)(((d) >> DATA_OFF_GENERATION) & GENERATION_MASK))
+
+
+// packs a search result into the 'data' field. The score is clamped to
+// the int16 range
+static inline uint64_t pack_tt_data(mv_bitmap move, int32_t score, enum score_bound bound,
+                                    uint8_t depth, uint8_t generation)
+{
+    if (score > INT16_MAX) {
+        score = INT16_MAX;
+    } else if (score < INT16_MIN) {
+        score = INT16_MIN;
+    }
+
+    return ((move >> MV_MASK_OFF_FROM_SQ) & 0xFFFFFF)
+           | ((uint64_t)(uint16_t)(int16_t)score << DATA_OFF_SCORE)
+           | ((uint64_t)depth << DATA_OFF_DEPTH)
+           | ((uint64_t)bound << DATA_OFF_BOUND)
+           | ((uint64_t)(generation & GENERATION_MASK) << DATA_OFF_GENERATION);
+}
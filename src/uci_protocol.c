@@ -27,11 +27,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <signal.h>
-#include <sys/select.h>
-#include <sys/time.h>
-#include <sys/types.h>
-#include <unistd.h>
+#include <pthread.h>
 
 #include "kestrel.h"
 #include "fen/fen.h"
@@ -39,41 +35,221 @@
 #include "move_gen_utils.h"
 #include "uci_protocol.h"
 #include "board.h"
+#include "pieces.h"
+#include "tt.h"
+#include "analysis_cache.h"
+#include "eval_cache.h"
+#include "time_manager.h"
+#include "mate_search.h"
 #include "utils.h"
 
-struct timeval tv;
-struct timezone tz;
-
 
 // NOTE : the code in this file was taken from BlueFever Software
 // and modified/adapter. Thanks guys :-)
 
 
+// the transposition table size, set via the UCI "Hash" option
+static uint32_t hash_size_in_bytes = UCI_HASH_DEFAULT_MB * 1024 * 1024;
+
+// the eval cache size, set via the UCI "EvalCache" option
+static uint32_t eval_cache_size_in_bytes = UCI_EVAL_CACHE_DEFAULT_MB * 1024 * 1024;
+
+// the number of search threads, set via the UCI "Threads" option
+static uint16_t num_threads = UCI_THREADS_DEFAULT;
+
+// how the search threads share the work, set via the UCI "SMPMode" option
+static enum smp_mode smp_mode = SMP_MODE_LAZY;
+
+// the number of best lines to search for, set via the UCI "MultiPV" option
+static uint8_t multi_pv = UCI_MULTI_PV_DEFAULT;
+
+// the search started by "go" runs in its own thread, so commands can
+// still be read (and "stop" and "isready" acted on) while it's searching
+static pthread_t search_thread;
+static bool search_thread_running = false;
+static struct search_info *go_search_info = NULL;
+static struct position *go_position = NULL;
+
+static void *search_thread_main(void *arg);
+
+
 /*
- * Prints best move in UCI format
+ * Prints best move in UCI format, with the move to ponder on (if any)
  */
-void uci_print_bestmove(mv_bitmap mv)
+void uci_print_bestmove(mv_bitmap mv, mv_bitmap ponder_mv)
 {
-    printf("bestmove %s\n", print_move(mv));
+    if (ponder_mv != NO_MOVE) {
+        // print_move() returns a static buffer
+        char move[8];
+        snprintf(move, sizeof(move), "%s", print_move(mv));
+        printf("bestmove %s ponder %s\n", move, print_move(ponder_mv));
+    } else {
+        printf("bestmove %s\n", print_move(mv));
+    }
 }
 
-void uci_print_info_score(int32_t best_score, uint8_t depth, uint32_t nodes, uint64_t time_in_ms, uint8_t num_pv_moves, mv_bitmap *pv_line)
+/*
+ * Prints the search progress in UCI format. Scores that are only bounds
+ * (from an aspiration window fail) are flagged as lowerbound/upperbound.
+ * When searching several lines (MultiPV), line_num is the line's rank,
+ * starting at 1, otherwise it's 0 and isn't printed.
+ */
+void uci_print_info_score(int32_t best_score, enum score_bound bound, uint8_t depth, uint8_t line_num, uint64_t nodes,
+                          uint64_t time_in_ms, uint8_t num_pv_moves, const mv_bitmap *pv_line)
 {
-    //printf("info score cp %d depth %d nodes %d time %jd ", best_score, depth, nodes,time_in_ms);
-    //printf("pv ");
-    //for(uint8_t i = 0; i < num_pv_moves; i++) {
-    //    printf(" %s", print_move(pv_line[i]));
-   // }
-    //printf("\n");
+    // the line is built up from several writes, which mustn't be
+    // interleaved with output from the UCI thread
+    flockfile(stdout);
+
+    printf("info depth %d ", depth);
+    if (line_num > 0) {
+        printf("multipv %u ", line_num);
+    }
+
+    if (best_score > MATE - MAX_SEARCH_DEPTH) {
+        printf("score mate %d", (MATE - best_score + 1) / 2);
+    } else if (best_score < -(MATE - MAX_SEARCH_DEPTH)) {
+        printf("score mate %d", -(MATE + best_score) / 2);
+    } else {
+        printf("score cp %d", best_score);
+    }
+
+    if (bound == BOUND_LOWER) {
+        printf(" lowerbound");
+    } else if (bound == BOUND_UPPER) {
+        printf(" upperbound");
+    }
+
+    printf(" nodes %ju time %ju pv", (uintmax_t)nodes, (uintmax_t)time_in_ms);
+    for(uint8_t i = 0; i < num_pv_moves; i++) {
+        printf(" %s", print_move(pv_line[i]));
+    }
+    printf("\n");
+
+    funlockfile(stdout);
+}
+
+/*
+ * Prints the root move being searched. The move number is the move's
+ * place in the root move list, starting at 1.
+ */
+void uci_print_info_currmove(uint8_t depth, mv_bitmap mv, uint16_t move_num)
+{
+    printf("info depth %d currmove %s currmovenumber %u\n", depth, print_move(mv), move_num);
 }
 
 void uci_print_hello()
 {
     printf("id name %s\n", ENGINE_NAME);
     printf("id author %s\n", AUTHOR);
+    printf("option name Hash type spin default %d min %d max %d\n",
+           UCI_HASH_DEFAULT_MB, UCI_HASH_MIN_MB, UCI_HASH_MAX_MB);
+    printf("option name EvalCache type spin default %d min %d max %d\n",
+           UCI_EVAL_CACHE_DEFAULT_MB, UCI_EVAL_CACHE_MIN_MB, UCI_EVAL_CACHE_MAX_MB);
+    printf("option name Threads type spin default %d min %d max %d\n",
+           UCI_THREADS_DEFAULT, UCI_THREADS_MIN, UCI_THREADS_MAX);
+    printf("option name SMPMode type combo default %s var %s var %s\n",
+           UCI_SMP_MODE_LAZY, UCI_SMP_MODE_LAZY, UCI_SMP_MODE_YBWC);
+    printf("option name Ponder type check default false\n");
+    printf("option name MultiPV type spin default %d min %d max %d\n",
+           UCI_MULTI_PV_DEFAULT, UCI_MULTI_PV_MIN, UCI_MULTI_PV_MAX);
+    printf("option name AnalysisCache type string default <empty>\n");
     printf("uciok\n");
 }
 
+
+// parses the UCI "setoption" command which is of the format
+// 		setoption name <id> [value <x>]
+void uci_parse_setoption(char *line)
+{
+    char *ptr = NULL;
+
+    if ((ptr = strstr(line, "name Hash value"))) {
+        int32_t mb = atoi(ptr + 16);	// skip over "name Hash value "
+        if (mb < UCI_HASH_MIN_MB) {
+            mb = UCI_HASH_MIN_MB;
+        }
+        if (mb > UCI_HASH_MAX_MB) {
+            mb = UCI_HASH_MAX_MB;
+        }
+        hash_size_in_bytes = (uint32_t)mb * 1024 * 1024;
+
+        // resize now, rather than at the start of the next search
+        create_tt_table(hash_size_in_bytes);
+        seed_tt_from_analysis_cache();
+    } else if ((ptr = strstr(line, "name EvalCache value"))) {
+        int32_t mb = atoi(ptr + 21);	// skip over "name EvalCache value "
+        if (mb < UCI_EVAL_CACHE_MIN_MB) {
+            mb = UCI_EVAL_CACHE_MIN_MB;
+        }
+        if (mb > UCI_EVAL_CACHE_MAX_MB) {
+            mb = UCI_EVAL_CACHE_MAX_MB;
+        }
+        eval_cache_size_in_bytes = (uint32_t)mb * 1024 * 1024;
+        create_eval_cache(eval_cache_size_in_bytes);
+    } else if ((ptr = strstr(line, "name Threads value"))) {
+        int32_t threads = atoi(ptr + 19);	// skip over "name Threads value "
+        if (threads < UCI_THREADS_MIN) {
+            threads = UCI_THREADS_MIN;
+        }
+        if (threads > UCI_THREADS_MAX) {
+            threads = UCI_THREADS_MAX;
+        }
+        num_threads = (uint16_t)threads;
+    } else if ((ptr = strstr(line, "name SMPMode value"))) {
+        ptr += 19;	// skip over "name SMPMode value "
+        if (strncmp(ptr, UCI_SMP_MODE_YBWC, strlen(UCI_SMP_MODE_YBWC)) == 0) {
+            smp_mode = SMP_MODE_YBWC;
+        } else {
+            smp_mode = SMP_MODE_LAZY;
+        }
+    } else if ((ptr = strstr(line, "name MultiPV value"))) {
+        int32_t lines = atoi(ptr + 19);	// skip over "name MultiPV value "
+        if (lines < UCI_MULTI_PV_MIN) {
+            lines = UCI_MULTI_PV_MIN;
+        }
+        if (lines > UCI_MULTI_PV_MAX) {
+            lines = UCI_MULTI_PV_MAX;
+        }
+        multi_pv = (uint8_t)lines;
+    } else if ((ptr = strstr(line, "name AnalysisCache value"))) {
+        ptr += 25;	// skip over "name AnalysisCache value "
+
+        // strip the trailing newline
+        char *endc = strchr(ptr, '\n');
+        if (endc) {
+            *endc = 0;
+        }
+
+        if (strlen(ptr) == 0 || strcmp(ptr, "<empty>") == 0) {
+            close_analysis_cache();
+        } else if (open_analysis_cache(ptr, ANALYSIS_CACHE_DEFAULT_MB)) {
+            uint32_t count = seed_tt_from_analysis_cache();
+            printf("info string analysis cache %s, %u positions\n", ptr, count);
+        }
+    }
+}
+
+uint32_t uci_get_hash_size(void)
+{
+    return hash_size_in_bytes;
+}
+
+uint32_t uci_get_eval_cache_size(void)
+{
+    return eval_cache_size_in_bytes;
+}
+
+uint16_t uci_get_num_threads(void)
+{
+    return num_threads;
+}
+
+enum smp_mode uci_get_smp_mode(void)
+{
+    return smp_mode;
+}
+
 // parses the UCI "position" command which is of the format
 // 		position [fen <fenstring> | startpos ]  moves <move1> .... <movei>
 // The line argument points to the start of the string, and includes
@@ -85,6 +261,9 @@ void uci_parse_position(char *line, struct position *pos)
     line += 9;
     char *pc = line;
 
+    // the FEN only adds pieces to the board
+    reset_board(pos);
+
     if(strncmp(line, "startpos", 8) == 0) {
         consume_fen_notation(STARTING_FEN, pos);
     } else {
@@ -123,36 +302,9 @@ void uci_parse_position(char *line, struct position *pos)
 
 }
 
-#define NUM_BYTES	256
-void read_input(struct search_info *si)
-{
-    ssize_t bytes;
-
-    char input[NUM_BYTES] = "", *endc;
-
-    if (uci_check_input_buffer()) {
-        si->stop_search = true;
-        do {
-            bytes=read(fileno(stdin),input,NUM_BYTES);
-        } while (bytes<0);
-
-        endc = strchr(input,'\n');
-        if (endc) {
-            *endc=0;
-        }
-
-        if (strlen(input) > 0) {
-            if (!strncmp(input, "quit", 4))    {
-                si->exit = true;
-            }
-        }
-        return;
-    }
-}
-
-
 /*
- * Parses the "go" command.
+ * Parses the "go" command, setting up the search info from it. The
+ * search itself is started by uci_start_search().
  *
  * The spec for the go command is as follows:
  *
@@ -199,94 +351,185 @@ void read_input(struct search_info *si)
 
  */
 
-void uci_parse_go(char *line, struct search_info *si, struct position *pos)
+void uci_parse_go(const char *line, struct search_info *si, struct position *pos)
 {
 
     int32_t depth = -1;
-    int32_t move_time = -1;
-    int32_t time = -1;
-    int32_t incr = -1;
-    int32_t moves_to_go = -1;
     char *ptr = NULL;
 
-    si->search_time_set = false;
+    struct time_control tc = {
+        .time_left = -1,
+        .increment = 0,
+        .moves_to_go = 0,
+        .move_time = -1
+    };
 
     if ((ptr = strstr(line,"infinite"))) {
-        ;
+        si->infinite = true;
+    }
+    // search the position after the expected reply, without a time
+    // limit until "ponderhit"
+    if ((ptr = strstr(line,"ponder"))) {
+        si->ponder = true;
     }
 
     // black incr per move in ms
     if ((ptr = strstr(line,"binc")) && get_side_to_move(pos) == BLACK) {
-        incr = atoi(ptr + 5);	// skip over "binc "
+        tc.increment = atoi(ptr + 5);	// skip over "binc "
     }
     // white incr per move in ms
     if ((ptr = strstr(line,"winc")) && get_side_to_move(pos) == WHITE) {
-        incr = atoi(ptr + 5);	// skip over "winc "
+        tc.increment = atoi(ptr + 5);	// skip over "winc "
     }
     // white's remaining time in ms
     if ((ptr = strstr(line,"wtime")) && get_side_to_move(pos) == WHITE) {
-        time = atoi(ptr + 6); 	// skip over "wtime "
+        tc.time_left = atoi(ptr + 6); 	// skip over "wtime "
     }
 
     // black's remaining time in ms
     if ((ptr = strstr(line,"btime")) && get_side_to_move(pos) == BLACK) {
-        time = atoi(ptr + 6);	// skip over "btime "
+        tc.time_left = atoi(ptr + 6);	// skip over "btime "
     }
 
     if ((ptr = strstr(line,"movestogo"))) {
-        moves_to_go = atoi(ptr + 10);	// skip over "movestogo "
+        tc.moves_to_go = atoi(ptr + 10);	// skip over "movestogo "
     }
     // time allowed for searching in ms
     if ((ptr = strstr(line,"movetime"))) {
-        move_time = atoi(ptr + 9);		// skip over "movetime "
+        tc.move_time = atoi(ptr + 9);		// skip over "movetime "
     }
     // number of plies to search
     if ((ptr = strstr(line,"depth"))) {
         depth = atoi(ptr + 6);		// skip over "depth "
     }
-
-    if(move_time != -1) {
-        time = move_time;
-        moves_to_go = 1;
+    // number of nodes to search
+    if ((ptr = strstr(line,"nodes"))) {
+        si->node_limit = strtoull(ptr + 6, NULL, 10);	// skip over "nodes "
+    }
+    // search for a mate in x moves
+    if ((ptr = strstr(line,"mate"))) {
+        int32_t moves = atoi(ptr + 5);		// skip over "mate "
+        if (moves > MATE_SEARCH_MAX_MOVES) {
+            moves = MATE_SEARCH_MAX_MOVES;
+        }
+        si->mate_moves = (moves > 0) ? (uint8_t)moves : 0;
     }
 
-    si->search_start_time = get_time_of_day_in_millis();
-    si->depth = (uint8_t)depth;
+    // root moves to search, up to the first token that isn't a move
+    if ((ptr = strstr(line,"searchmoves"))) {
+        ptr += 12;		// skip over "searchmoves "
+        while (*ptr && si->num_search_moves < MAX_POSITION_MOVES) {
+            mv_bitmap mv = parse_move(ptr, pos);
+            if (mv == NO_MOVE) {
+                break;
+            }
+            si->search_moves[si->num_search_moves++] = mv;
 
-    if(time != -1) {
-        si->search_time_set = true;
-        time /= moves_to_go;
-        time -= 50;
-        si->search_expiry_time = si->search_start_time
-                                 + (uint64_t)time
-                                 + (uint64_t)incr;
+            while (*ptr && *ptr != ' ') {
+                ptr++;
+            }
+            while (*ptr == ' ') {
+                ptr++;
+            }
+        }
     }
 
+    si->depth = (uint8_t)depth;
+    si->num_threads = num_threads;
+    si->smp_mode = smp_mode;
+    si->multi_pv = multi_pv;
+    si->search_time_set = calc_time_limits(&tc, &si->time_limits);
+
     if(depth == -1) {
         si->depth = MAX_SEARCH_DEPTH;
     }
 
-    printf("time:%d start:%jd stop:%jd depth:%d timeset:%i\n",
-           time,si->search_start_time,si->search_expiry_time, si->depth,
-           (int)si->search_time_set);
-    search_positions(pos, si, 640000000);
+    if (si->search_time_set) {
+        printf("info string optimum time %u maximum time %u\n",
+               si->time_limits.optimum_ms, si->time_limits.maximum_ms);
+    }
 }
 
 
 
-// code taken from http://home.arcor.de/dreamlike/chess/
-int uci_check_input_buffer()
+
+/*
+ * Starts searching the position in a new thread, as set out by a "go"
+ * command. Any search that's already running is stopped first. The
+ * command is parsed on the calling thread, so the search info is set up
+ * before any following command (eg, "ponderhit") is read. The search
+ * prints "bestmove" when it finishes.
+ *
+ * name: uci_start_search
+ * @param	line - the "go" command
+ * @param	si - the search info, reset for the new search
+ * @param	pos - the position to search, not to be changed until the search has finished
+ * @return
+ *
+ */
+void uci_start_search(const char *line, struct search_info *si, struct position *pos)
+{
+    uci_stop_search(si);
+
+    init_search_struct(si);
+    uci_parse_go(line, si, pos);
+
+    go_search_info = si;
+    go_position = pos;
+
+    if (pthread_create(&search_thread, NULL, search_thread_main, NULL) != 0) {
+        printf("unable to create search thread\n");
+        exit(-1);
+    }
+    search_thread_running = true;
+}
+
+
+/*
+ * Stops the running search (if any), and waits for it to finish. The
+ * search prints its best move before the thread exits.
+ *
+ * name: uci_stop_search
+ * @param	si - the search info passed to uci_start_search()
+ * @return
+ *
+ */
+void uci_stop_search(struct search_info *si)
 {
+    if (search_thread_running == false) {
+        return;
+    }
 
-    fd_set readfds;
+    request_search_stop(si);
+    pthread_join(search_thread, NULL);
+    search_thread_running = false;
+}
 
-    FD_ZERO (&readfds);
-    FD_SET (fileno(stdin), &readfds);
-    tv.tv_sec=0;
-    tv.tv_usec=0;
-    select(16, &readfds, 0, 0, &tv);
 
-    return (FD_ISSET(fileno(stdin), &readfds));
+/*
+ * Handles "ponderhit": the opponent played the expected move, so the
+ * pondering search becomes the search for this move.
+ *
+ * name: uci_ponderhit
+ * @param	si - the search info passed to uci_start_search()
+ * @return
+ *
+ */
+void uci_ponderhit(struct search_info *si)
+{
+    if (search_thread_running == false) {
+        return;
+    }
+
+    ponder_hit(si);
+}
+
+
+static void *search_thread_main(void *arg)
+{
+    (void)arg;
+    search_positions(go_position, go_search_info, hash_size_in_bytes);
+    return NULL;
 }
 
 void uci_print_ready()
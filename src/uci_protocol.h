@@ -26,14 +26,45 @@
 #include <stdio.h>
 #include "kestrel.h"
 #include "search.h"
+#include "tt.h"
+
+// "Hash" option, in MB
+#define UCI_HASH_DEFAULT_MB		64
+#define UCI_HASH_MIN_MB			1
+#define UCI_HASH_MAX_MB			4095
+
+// "EvalCache" option, in MB (0 disables the cache)
+#define UCI_EVAL_CACHE_DEFAULT_MB	8
+#define UCI_EVAL_CACHE_MIN_MB		0
+#define UCI_EVAL_CACHE_MAX_MB		1024
+
+// "Threads" option
+#define UCI_THREADS_DEFAULT		1
+#define UCI_THREADS_MIN			1
+#define UCI_THREADS_MAX			MAX_SEARCH_THREADS
+
+// "SMPMode" option values
+#define UCI_SMP_MODE_LAZY		"LazySMP"
+#define UCI_SMP_MODE_YBWC		"YBWC"
+
+// "MultiPV" option
+#define UCI_MULTI_PV_DEFAULT	1
+#define UCI_MULTI_PV_MIN		1
+#define UCI_MULTI_PV_MAX		MAX_MULTI_PV
 
 void uci_print_hello(void);
-void read_input(struct search_info *si);
 void uci_print_ready(void);
-int uci_check_input_buffer(void);
 void uci_parse_position(char *line, struct position *pos);
-void uci_print_bestmove(mv_bitmap mv);
-void uci_parse_go(char *line, struct search_info *si, struct position *pos);
-void uci_print_info_score(int32_t best_score, uint8_t depth, uint32_t nodes,
-                          uint64_t time_in_ms, uint8_t num_pv_moves, mv_bitmap *pv_line);
-
+void uci_print_bestmove(mv_bitmap mv, mv_bitmap ponder_mv);
+void uci_parse_go(const char *line, struct search_info *si, struct position *pos);
+void uci_start_search(const char *line, struct search_info *si, struct position *pos);
+void uci_stop_search(struct search_info *si);
+void uci_ponderhit(struct search_info *si);
+void uci_parse_setoption(char *line);
+uint32_t uci_get_hash_size(void);
+uint32_t uci_get_eval_cache_size(void);
+uint16_t uci_get_num_threads(void);
+enum smp_mode uci_get_smp_mode(void);
+void uci_print_info_score(int32_t best_score, enum score_bound bound, uint8_t depth, uint8_t line_num, uint64_t nodes,
+                          uint64_t time_in_ms, uint8_t num_pv_moves, const mv_bitmap *pv_line);
+void uci_print_info_currmove(uint8_t depth, mv_bitmap mv, uint16_t move_num);
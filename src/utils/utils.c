@@ -27,25 +27,25 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <ctype.h>
-#include <sched.h>
+#include <time.h>
 #include <sys/times.h>
-#include <sys/time.h>
 #include <sys/resource.h>
 #include "kestrel.h"
 #include "utils.h"
 
 
 
-void set_priority_and_affinity(void)
+/*
+ * Raises the process priority. The process isn't pinned to a CPU, so the
+ * search threads can be spread across all the available cores.
+ *
+ * name: set_process_priority
+ * @param
+ * @return
+ *
+ */
+void set_process_priority(void)
 {
-    // set up CPU affinity
-    cpu_set_t my_set;
-    CPU_ZERO(&my_set);
-    CPU_SET(1, &my_set);
-    if (sched_setaffinity(0, sizeof(cpu_set_t), &my_set) > 0) {
-        printf("affinity error");
-        exit(-1);
-    }
     // set process priority to max
     if (setpriority(PRIO_PROCESS, 0, PRIO_MAX) != 0) {
         printf("process priority error");
@@ -77,22 +77,34 @@ print_stacktrace (void)
 
 
 
-uint64_t get_time_of_day_in_millis(void)
+/*
+ * Reads the monotonic clock, which (unlike the time of day) never jumps
+ * when the system clock is changed, so it's safe for timing searches.
+ *
+ * name: get_monotonic_time_in_micros
+ * @param
+ * @return	the time in microseconds since an arbitrary starting point
+ *
+ */
+uint64_t get_monotonic_time_in_micros(void)
 {
-    struct timeval tp;
-
-    int errno = gettimeofday(&tp, NULL);
+    struct timespec ts;
 
-    if (errno == 0) {
-        return (uint64_t) (tp.tv_sec * 1000 + tp.tv_usec / 1000);
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
     }
 
     return 0;
 }
 
+uint64_t get_monotonic_time_in_millis(void)
+{
+    return get_monotonic_time_in_micros() / 1000;
+}
+
 uint64_t get_elapsed_time_in_millis(uint64_t start_time)
 {
-    uint64_t now_in_millis = get_time_of_day_in_millis();
+    uint64_t now_in_millis = get_monotonic_time_in_millis();
     return (now_in_millis - start_time);
 }
 
@@ -21,7 +21,8 @@
 #include "kestrel.h"
 
 
-void set_priority_and_affinity(void);
-uint64_t get_time_of_day_in_millis(void);
+void set_process_priority(void);
+uint64_t get_monotonic_time_in_micros(void);
+uint64_t get_monotonic_time_in_millis(void);
 uint64_t get_elapsed_time_in_millis(uint64_t start_time);
 void print_stacktrace (void);
@@ -27,6 +27,12 @@
 #include "piece_test_fixture.h"
 #include "utils_test_feature.h"
 #include "search_tests.h"
+#include "time_manager_tests.h"
+#include "move_history_tests.h"
+#include "root_moves_tests.h"
+#include "tt_tests.h"
+#include "analysis_cache_tests.h"
+#include "eval_cache_tests.h"
 
 
 void all_tests(void);
@@ -41,7 +47,7 @@ void all_tests(void)
 {
 	
 	
-    set_priority_and_affinity();
+    set_process_priority();
 
     // add new test fixtures here.
     board_test_fixture();
@@ -51,6 +57,12 @@ void all_tests(void)
     attack_test_fixture();
     utils_test_fixture();
     search_test_fixture();
+    time_manager_test_fixture();
+    move_history_test_fixture();
+    root_moves_test_fixture();
+    tt_test_fixture();
+    analysis_cache_test_fixture();
+    eval_cache_test_fixture();
     perf_test_fixture();
 
 }
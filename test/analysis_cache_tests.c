@@ -0,0 +1,152 @@
+/*
+ * analysis_cache_tests.c
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "seatest.h"
+#include "kestrel.h"
+#include "board.h"
+#include "fen/fen.h"
+#include "move_gen.h"
+#include "move_gen_utils.h"
+#include "hashkeys.h"
+#include "tt.h"
+#include "analysis_cache.h"
+#include "analysis_cache_tests.h"
+
+
+#define TEST_CACHE_FILE		"/tmp/kestrel_analysis_cache_test.bin"
+#define TEST_CACHE_MB		1
+
+
+void test_analysis_cache_survives_reopen(void);
+void test_tt_seeded_with_cached_scores(void);
+void test_hash_keys_are_repeatable(void);
+
+static mv_bitmap get_first_move(void);
+
+
+void test_analysis_cache_survives_reopen(void)
+{
+    const uint64_t hash = 0x0F1E2D3C4B5A6978ULL;
+    const uint64_t shallow_hash = 0x1122334455667788ULL;
+    mv_bitmap mv = get_first_move();
+
+    unlink(TEST_CACHE_FILE);
+    assert_true(open_analysis_cache(TEST_CACHE_FILE, TEST_CACHE_MB));
+
+    add_to_analysis_cache(hash, mv, -123, BOUND_EXACT, ANALYSIS_CACHE_MIN_DEPTH + 2);
+    add_to_analysis_cache(shallow_hash, mv, 50, BOUND_EXACT, ANALYSIS_CACHE_MIN_DEPTH - 1);
+    close_analysis_cache();
+    assert_false(is_analysis_cache_open());
+
+    // the size is only used for a new file
+    assert_true(open_analysis_cache(TEST_CACHE_FILE, TEST_CACHE_MB * 4));
+
+    struct analysis_cache_entry_info info;
+    assert_true(probe_analysis_cache(hash, &info));
+    assert_true(info.move == get_move(mv));
+    assert_true(info.score == -123);
+    assert_true(info.bound == BOUND_EXACT);
+    assert_true(info.depth == ANALYSIS_CACHE_MIN_DEPTH + 2);
+
+    // too shallow to be kept
+    assert_false(probe_analysis_cache(shallow_hash, &info));
+
+    close_analysis_cache();
+    unlink(TEST_CACHE_FILE);
+}
+
+
+void test_tt_seeded_with_cached_scores(void)
+{
+    const uint64_t hash = 0x0F1E2D3C4B5A6978ULL;
+    mv_bitmap mv = get_first_move();
+
+    unlink(TEST_CACHE_FILE);
+    assert_true(open_analysis_cache(TEST_CACHE_FILE, TEST_CACHE_MB));
+    add_to_analysis_cache(hash, mv, 77, BOUND_EXACT, ANALYSIS_CACHE_MIN_DEPTH);
+
+    create_tt_table(64000000);
+    clear_tt_table();
+    assert_true(seed_tt_from_analysis_cache() == 1);
+
+    struct tt_entry_info tte;
+    assert_true(probe_tt_entry(hash, &tte));
+    assert_true(tte.move == get_move(mv));
+    assert_true(tte.score == 77);
+    assert_true(tte.bound == BOUND_EXACT);
+    assert_true(tte.depth == ANALYSIS_CACHE_MIN_DEPTH);
+
+    clear_tt_table();
+    close_analysis_cache();
+    unlink(TEST_CACHE_FILE);
+}
+
+
+// the cache file is only valid while the keys are the same from one run
+// to the next
+void test_hash_keys_are_repeatable(void)
+{
+    struct position *pos = allocate_board();
+
+    init_hash_keys_with_seed(ZOBRIST_FIXED_SEED);
+    uint64_t signature = get_hash_key_signature();
+    consume_fen_notation(STARTING_FEN, pos);
+    uint64_t hash = get_board_hash(pos);
+
+    init_hash_keys_with_seed(ZOBRIST_FIXED_SEED + 1);
+    assert_true(get_hash_key_signature() != signature);
+
+    init_hash_keys();
+    assert_true(get_hash_key_signature() == signature);
+    assert_true(get_position_hash(pos) == hash);
+
+    free_board(pos);
+}
+
+
+static mv_bitmap get_first_move(void)
+{
+    struct position *pos = allocate_board();
+    consume_fen_notation(STARTING_FEN, pos);
+
+    struct move_list mvl = {
+        .moves = {0},
+        .move_count = 0
+    };
+    generate_all_moves(pos, &mvl);
+    mv_bitmap mv = mvl.moves[0];
+
+    free_board(pos);
+    return mv;
+}
+
+
+void analysis_cache_test_fixture(void)
+{
+    test_fixture_start();	// starts a fixture
+
+    run_test(test_analysis_cache_survives_reopen);
+    run_test(test_tt_seeded_with_cached_scores);
+    run_test(test_hash_keys_are_repeatable);
+
+    test_fixture_end();	// ends a fixture
+}
@@ -41,6 +41,9 @@ void test_is_square_being_attacked_by_rook(void);
 void test_is_square_being_attacked_by_bishop(void);
 void test_is_square_attacked_by_queen(void);
 void test_is_square_under_attack(void);
+void test_get_attackers_to_square(void);
+void test_see(void);
+static int32_t see_for_fen(char *fen, mv_bitmap mv);
 void test_is_blocked_up_or_down(void);
 void test_is_blocked_diagonally(void);
 void test_inbetween_bits(void);
@@ -505,6 +508,69 @@ bool TEST_is_attacked_diagonally(const struct position *pos,
 
 
 
+void test_get_attackers_to_square(void)
+{
+    char *test_fen =
+        "2Q3qb/pN3P1p/P4qr1/1KP1BnP1/1p2pPNp/2rkP3/pP3npP/4QbRB w - - 0 1";
+
+    struct position *pos = allocate_board();
+    consume_fen_notation(test_fen, pos);
+
+    const struct bitboards *bb = get_bitboard_struct(pos);
+    uint64_t occupied = get_bitboard_all_pieces(bb);
+
+    // should agree with is_sq_attacked() for every square
+    for (enum square sq = a1; sq <= h8; sq++) {
+        uint64_t attackers = get_attackers_to_square(pos, sq, occupied);
+
+        bool white_att = (attackers & get_bitboard_for_colour(bb, WHITE)) != 0;
+        bool black_att = (attackers & get_bitboard_for_colour(bb, BLACK)) != 0;
+        assert_true(white_att == is_sq_attacked(pos, sq, WHITE));
+        assert_true(black_att == is_sq_attacked(pos, sq, BLACK));
+    }
+
+    free_board(pos);
+}
+
+
+void test_see(void)
+{
+    // pawn takes undefended pawn
+    mv_bitmap mv = MOVE(e4, d5, B_PAWN, NO_PIECE, MFLAG_CAPTURE);
+    assert_true(see_for_fen("4k3/8/8/3p4/4P3/8/8/4K3 w - - 0 1", mv) == 100);
+
+    // rook takes pawn defended by a pawn
+    mv = MOVE(d1, d5, B_PAWN, NO_PIECE, MFLAG_CAPTURE);
+    assert_true(see_for_fen("4k3/8/4p3/3p4/8/8/8/3RK3 w - - 0 1", mv) == 100 - 550);
+
+    // doubled rooks win a pawn defended by a rook (x-ray)
+    mv = MOVE(d2, d5, B_PAWN, NO_PIECE, MFLAG_CAPTURE);
+    assert_true(see_for_fen("3rk3/8/8/3p4/8/8/3R4/3RK3 w - - 0 1", mv) == 100);
+
+    // queen takes pawn defended by a knight
+    mv = MOVE(d2, d5, B_PAWN, NO_PIECE, MFLAG_CAPTURE);
+    assert_true(see_for_fen("4k3/8/5n2/3p4/8/8/3Q4/4K3 w - - 0 1", mv) == 100 - 1000);
+
+    // the king can't recapture, as the queen x-rays through the rook
+    mv = MOVE(d7, d2, W_KNIGHT, NO_PIECE, MFLAG_CAPTURE);
+    assert_true(see_for_fen("3qk3/3r4/8/8/8/8/3N4/4K3 b - - 0 1", mv) == 325);
+
+    // en passant
+    mv = MOVE(e5, d6, B_PAWN, NO_PIECE, MFLAG_EN_PASSANT);
+    assert_true(see_for_fen("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", mv) == 100);
+}
+
+
+static int32_t see_for_fen(char *fen, mv_bitmap mv)
+{
+    struct position *pos = allocate_board();
+    consume_fen_notation(fen, pos);
+    int32_t retval = see(pos, mv);
+    free_board(pos);
+    return retval;
+}
+
+
 void attack_test_fixture(void)
 {
     test_fixture_start();	// starts a fixture
@@ -513,6 +579,8 @@ void attack_test_fixture(void)
     run_test(test_is_square_being_attacked_by_pawn);
     run_test(test_is_square_being_attacked_by_king);
     run_test(test_is_square_under_attack);
+    run_test(test_get_attackers_to_square);
+    run_test(test_see);
 
     //run_test(debug_move);
 
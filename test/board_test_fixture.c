@@ -816,7 +816,6 @@ void assert_boards_are_equal(const struct board *pos1, const struct board *pos2)
 mv_bitmap get_best_pvline(const struct board *pos);
 mv_bitmap get_pvline(const struct board *pos, uint8_t search_depth);
 void set_pvline(struct board *pos, uint8_t search_depth, mv_bitmap move);
-uint8_t populate_pv_line(struct board *pos, uint8_t depth);
 
 
 
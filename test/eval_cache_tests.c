@@ -0,0 +1,108 @@
+/*
+ * eval_cache_tests.c
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "seatest.h"
+#include "kestrel.h"
+#include "board.h"
+#include "fen/fen.h"
+#include "evaluate.h"
+#include "eval_cache.h"
+#include "uci_protocol.h"
+#include "eval_cache_tests.h"
+
+
+void test_eval_cache_hit(void);
+void test_eval_cache_resized_by_setoption(void);
+
+
+void test_eval_cache_hit(void)
+{
+    struct position *pos = allocate_board();
+    consume_fen_notation("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4", pos);
+
+    create_eval_cache(1024 * 1024);
+    reset_eval_cache_stats();
+
+    struct eval_cache_stats stats;
+    int32_t score1 = evaluate_position(pos);
+    get_eval_cache_stats(&stats);
+    assert_true(stats.probes == 1);
+    assert_true(stats.hits == 0);
+
+    int32_t score2 = evaluate_position(pos);
+    get_eval_cache_stats(&stats);
+    assert_true(stats.probes == 2);
+    assert_true(stats.hits == 1);
+    assert_int_equal(score1, score2);
+
+    dispose_eval_cache();
+    free_board(pos);
+}
+
+
+void test_eval_cache_resized_by_setoption(void)
+{
+    struct position *pos = allocate_board();
+    consume_fen_notation(STARTING_FEN, pos);
+    struct eval_cache_stats stats;
+
+    char enable[] = "setoption name EvalCache value 1\n";
+    uci_parse_setoption(enable);
+    reset_eval_cache_stats();
+    evaluate_position(pos);
+    evaluate_position(pos);
+    get_eval_cache_stats(&stats);
+    assert_true(stats.hits == 1);
+
+    // a size of 0 disables the cache, so nothing is probed
+    char disable[] = "setoption name EvalCache value 0\n";
+    uci_parse_setoption(disable);
+    reset_eval_cache_stats();
+    evaluate_position(pos);
+    get_eval_cache_stats(&stats);
+    assert_true(stats.probes == 0);
+
+    // the new cache starts empty
+    char resize[] = "setoption name EvalCache value 2\n";
+    uci_parse_setoption(resize);
+    reset_eval_cache_stats();
+    evaluate_position(pos);
+    get_eval_cache_stats(&stats);
+    assert_true(stats.probes == 1);
+    assert_true(stats.hits == 0);
+    evaluate_position(pos);
+    get_eval_cache_stats(&stats);
+    assert_true(stats.hits == 1);
+
+    dispose_eval_cache();
+    free_board(pos);
+}
+
+
+void eval_cache_test_fixture(void)
+{
+    test_fixture_start();	// starts a fixture
+
+    run_test(test_eval_cache_hit);
+    run_test(test_eval_cache_resized_by_setoption);
+
+    test_fixture_end();	// ends a fixture
+}
@@ -0,0 +1,165 @@
+/*
+ * move_history_tests.c
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "seatest.h"
+#include "kestrel.h"
+#include "board.h"
+#include "fen/fen.h"
+#include "move_gen.h"
+#include "move_gen_utils.h"
+#include "search.h"
+#include "move_history.h"
+#include "move_history_tests.h"
+
+
+void test_best_quiet_move_ordered_first(void);
+void test_history_is_bounded(void);
+void test_no_context_after_null_move(void);
+
+static mv_bitmap find_move(struct position *pos, enum square from, enum square to);
+
+
+void test_best_quiet_move_ordered_first(void)
+{
+    struct position *pos = allocate_board();
+    consume_fen_notation(STARTING_FEN, pos);
+    make_move(pos, find_move(pos, e2, e4));
+
+    struct move_history *mh = create_move_history();
+    struct move_context ctx;
+    get_move_context(mh, pos, &ctx);
+    assert_true(ctx.counter_move != NULL);
+    assert_true(ctx.continuation[0] != NULL);
+    assert_true(ctx.continuation[1] == NULL);
+
+    // a7a6 and b7b6 were tried before g8f6, which cut off
+    mv_bitmap a7a6 = find_move(pos, a7, a6);
+    mv_bitmap b7b6 = find_move(pos, b7, b6);
+    mv_bitmap g8f6 = find_move(pos, g8, f6);
+    mv_bitmap tried[] = {a7a6, b7b6, g8f6};
+    update_quiet_history(mh, &ctx, pos, g8f6, tried, 3, 4);
+
+    assert_true(*ctx.counter_move == get_move(g8f6));
+
+    struct move_list mvl = {
+        .moves = {0},
+        .move_count = 0
+    };
+    generate_all_moves(pos, &mvl);
+    score_quiet_moves(mh, &ctx, pos, &mvl);
+
+    bring_best_move_to_top(0, &mvl);
+    assert_true(get_move(mvl.moves[0]) == get_move(g8f6));
+
+    // the moves tried first are now ordered below the untried moves
+    for(uint16_t i = 0; i < mvl.move_count; i++) {
+        mv_bitmap mv = get_move(mvl.moves[i]);
+        if (mv == get_move(a7a6) || mv == get_move(b7b6)) {
+            assert_true(get_score(mvl.moves[i]) < MOVE_ORDER_WEIGHT_HISTORY);
+        } else if (mv != get_move(g8f6)) {
+            assert_true(get_score(mvl.moves[i]) == MOVE_ORDER_WEIGHT_HISTORY);
+        }
+    }
+
+    dispose_move_history(mh);
+    free_board(pos);
+}
+
+
+void test_history_is_bounded(void)
+{
+    struct position *pos = allocate_board();
+    consume_fen_notation(STARTING_FEN, pos);
+    make_move(pos, find_move(pos, e2, e4));
+    make_move(pos, find_move(pos, e7, e5));
+
+    struct move_history *mh = create_move_history();
+    struct move_context ctx;
+    get_move_context(mh, pos, &ctx);
+    assert_true(ctx.continuation[1] != NULL);
+
+    mv_bitmap g1f3 = find_move(pos, g1, f3);
+    mv_bitmap a2a3 = find_move(pos, a2, a3);
+    mv_bitmap tried[] = {a2a3, g1f3};
+    for(uint32_t i = 0; i < 1000; i++) {
+        update_quiet_history(mh, &ctx, pos, g1f3, tried, 2, MAX_SEARCH_DEPTH);
+    }
+
+    assert_true(mh->history[W_KNIGHT][f3] > 0);
+    assert_true(mh->history[W_KNIGHT][f3] <= HISTORY_MAX);
+    assert_true(mh->history[W_PAWN][a3] < 0);
+    assert_true(mh->history[W_PAWN][a3] >= -HISTORY_MAX);
+    for(uint8_t i = 0; i < NUM_CONTINUATION_PLIES; i++) {
+        assert_true((*ctx.continuation[i])[W_KNIGHT][f3] <= HISTORY_MAX);
+        assert_true((*ctx.continuation[i])[W_PAWN][a3] >= -HISTORY_MAX);
+    }
+
+    dispose_move_history(mh);
+    free_board(pos);
+}
+
+
+void test_no_context_after_null_move(void)
+{
+    struct position *pos = allocate_board();
+    consume_fen_notation(STARTING_FEN, pos);
+    make_move(pos, find_move(pos, e2, e4));
+    make_null_move(pos);
+
+    struct move_history *mh = create_move_history();
+    struct move_context ctx;
+    get_move_context(mh, pos, &ctx);
+    assert_true(ctx.counter_move == NULL);
+    assert_true(ctx.continuation[0] == NULL);
+    assert_true(ctx.continuation[1] == NULL);
+
+    dispose_move_history(mh);
+    free_board(pos);
+}
+
+
+static mv_bitmap find_move(struct position *pos, enum square from, enum square to)
+{
+    struct move_list mvl = {
+        .moves = {0},
+        .move_count = 0
+    };
+    generate_all_moves(pos, &mvl);
+
+    for(uint16_t i = 0; i < mvl.move_count; i++) {
+        if (FROMSQ(mvl.moves[i]) == from && TOSQ(mvl.moves[i]) == to) {
+            return mvl.moves[i];
+        }
+    }
+    return NO_MOVE;
+}
+
+
+void move_history_test_fixture(void)
+{
+    test_fixture_start();	// starts a fixture
+
+    run_test(test_best_quiet_move_ordered_first);
+    run_test(test_history_is_bounded);
+    run_test(test_no_context_after_null_move);
+
+    test_fixture_end();	// ends a fixture
+}
@@ -387,7 +387,7 @@ void test_move_gen_depth()
 		ASSERT_BOARD_OK(pos);
 #endif
 
-        start_time = get_time_of_day_in_millis();
+        start_time = get_monotonic_time_in_millis();
 
         ////////////
         leafNodes = 0;
@@ -426,7 +426,7 @@ void perf_test(int depth, struct position *pos, struct perft_stats *pstats)
         .move_count = 0
     };
 
-    start_time = get_time_of_day_in_millis();
+    start_time = get_monotonic_time_in_millis();
 
 #ifdef ENABLE_ASSERTS
 		ASSERT_BOARD_OK(pos);
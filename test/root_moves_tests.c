@@ -0,0 +1,149 @@
+/*
+ * root_moves_tests.c
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "seatest.h"
+#include "kestrel.h"
+#include "board.h"
+#include "pieces.h"
+#include "fen/fen.h"
+#include "move_gen.h"
+#include "move_gen_utils.h"
+#include "root_moves.h"
+#include "root_moves_tests.h"
+
+
+void test_root_moves_are_legal(void);
+void test_root_move_sort_is_stable(void);
+void test_root_node_share(void);
+
+static mv_bitmap find_move(struct position *pos, enum square from, enum square to);
+
+
+void test_root_moves_are_legal(void)
+{
+    // the white king is in check, and can only take the rook, or go to d1 or f1
+    struct position *pos = allocate_board();
+    consume_fen_notation("4k3/8/8/8/8/8/4r3/4K3 w - - 0 1", pos);
+
+    mv_bitmap e1f1 = find_move(pos, e1, f1);
+
+    struct root_move_list rml;
+    init_root_moves(pos, e1f1, &rml);
+
+    assert_true(rml.count == 3);
+    assert_true(rml.moves[0].move == get_move(e1f1));
+    assert_true(rml.moves[1].move == get_move(find_move(pos, e1, e2)));
+    for(uint16_t i = 0; i < rml.count; i++) {
+        assert_true(rml.moves[i].score == -INFINITE);
+        assert_true(rml.moves[i].nodes == 0);
+    }
+
+    free_board(pos);
+}
+
+
+void test_root_move_sort_is_stable(void)
+{
+    struct position *pos = allocate_board();
+    consume_fen_notation(STARTING_FEN, pos);
+
+    struct root_move_list rml;
+    init_root_moves(pos, NO_MOVE, &rml);
+    assert_true(rml.count == 20);
+
+    mv_bitmap first = rml.moves[0].move;
+    mv_bitmap second = rml.moves[1].move;
+    mv_bitmap last = rml.moves[19].move;
+
+    // the last move raised alpha, and the first one was searched first
+    // and failed low. The rest failed low, so keep their order
+    start_root_iteration(&rml);
+    rml.moves[0].score = 10;
+    rml.moves[19].score = 25;
+    sort_root_moves(&rml);
+
+    assert_true(rml.moves[0].move == last);
+    assert_true(rml.moves[1].move == first);
+    assert_true(rml.moves[2].move == second);
+
+    // in the next iteration, only the second move raised alpha. The
+    // previous scores decide between the moves that failed low
+    start_root_iteration(&rml);
+    assert_true(rml.moves[0].prev_score == 25);
+    assert_true(rml.moves[1].prev_score == 10);
+    rml.moves[2].score = 5;
+    sort_root_moves(&rml);
+
+    assert_true(rml.moves[0].move == second);
+    assert_true(rml.moves[1].move == last);
+    assert_true(rml.moves[2].move == first);
+
+    free_board(pos);
+}
+
+
+void test_root_node_share(void)
+{
+    struct position *pos = allocate_board();
+    consume_fen_notation(STARTING_FEN, pos);
+
+    struct root_move_list rml;
+    init_root_moves(pos, NO_MOVE, &rml);
+    assert_true(get_root_node_share(&rml, rml.moves[0].move) == 0.0);
+
+    rml.moves[0].nodes = 300;
+    rml.moves[1].nodes = 100;
+    assert_true(get_root_node_share(&rml, rml.moves[0].move) == 0.75);
+    assert_true(get_root_node_share(&rml, rml.moves[1].move) == 0.25);
+    assert_true(get_root_node_share(&rml, rml.moves[2].move) == 0.0);
+    assert_true(get_root_node_share(&rml, NO_MOVE) == 0.0);
+
+    free_board(pos);
+}
+
+
+static mv_bitmap find_move(struct position *pos, enum square from, enum square to)
+{
+    struct move_list mvl = {
+        .moves = {0},
+        .move_count = 0
+    };
+    generate_all_moves(pos, &mvl);
+
+    for(uint16_t i = 0; i < mvl.move_count; i++) {
+        if (FROMSQ(mvl.moves[i]) == from && TOSQ(mvl.moves[i]) == to) {
+            return mvl.moves[i];
+        }
+    }
+    return NO_MOVE;
+}
+
+
+void root_moves_test_fixture(void)
+{
+    test_fixture_start();	// starts a fixture
+
+    run_test(test_root_moves_are_legal);
+    run_test(test_root_move_sort_is_stable);
+    run_test(test_root_node_share);
+
+    test_fixture_end();	// ends a fixture
+}
@@ -15,24 +15,41 @@
  * You should have received a copy of the GNU General Public License along
  * with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 #include "seatest.h"
 #include "kestrel.h"
 #include "board.h"
 #include "fen/fen.h"
 #include "search.h"
 #include "move_gen_utils.h"
+#include "board_utils.h"
+#include "tt.h"
+#include "utils.h"
+#include "mate_search.h"
 
 
 #define MATE_IN_TWO			"1r3rk1/1pnnq1bR/p1pp2B1/P2P1p2/1PP1pP2/2B3P1/5PK1/2Q4R w - - 0 1"
 
 void test_mate_in_two(void);
+void test_mate_in_two_extended(void);
+void test_search_stops_at_time_limit(void);
+void test_ponder_hit(void);
+void test_multi_pv(void);
+void test_search_moves(void);
+void test_node_limit_is_deterministic(void);
+void test_mate_search(void);
+void test_pv_is_full_length(void);
+void test_pv_includes_quiescence_captures(void);
+void test_ybwc_search_stops_mid_iteration(void);
 void test_move_sort_1(void);
+
 void search_test_fixture(void);
 
 
@@ -101,6 +118,292 @@ void test_mate_in_two()
 }
 
 
+// the check extension lets a 3 ply search see the mate
+void test_mate_in_two_extended()
+{
+	struct position *pos = allocate_board();
+	consume_fen_notation(MATE_IN_TWO, pos);
+
+    struct search_info si;
+
+    memset(&si, 0, sizeof(struct search_info));
+
+    si.depth = 3;
+    search_positions(pos, &si, 64000000);
+
+    mv_bitmap h7h8 = get_move(MOVE(h7, h8, NO_PIECE, NO_PIECE, 0));
+
+    assert_true(h7h8 == get_move(si.best_move));
+    assert_true(si.check_extensions > 0);
+
+	free_board(pos);
+}
+
+
+// the search timer stops a search that would otherwise run to the
+// maximum depth
+void test_search_stops_at_time_limit()
+{
+	struct position *pos = allocate_board();
+	consume_fen_notation(STARTING_FEN, pos);
+
+    struct search_info si;
+
+    memset(&si, 0, sizeof(struct search_info));
+
+    si.depth = MAX_SEARCH_DEPTH;
+    si.time_limits.optimum_ms = 50;
+    si.time_limits.maximum_ms = 50;
+    si.time_limits.fixed = true;
+    si.search_time_set = true;
+
+    uint64_t start_time = get_monotonic_time_in_millis();
+    search_positions(pos, &si, 64000000);
+    uint64_t elapsed = get_elapsed_time_in_millis(start_time);
+
+    assert_true(si.best_move != NO_MOVE);
+    assert_true(elapsed < 50 + 25);
+
+	free_board(pos);
+}
+
+
+static void *send_ponder_hit(void *arg)
+{
+    const struct timespec delay = { .tv_sec = 0, .tv_nsec = 100 * 1000000 };
+    nanosleep(&delay, NULL);
+    ponder_hit((struct search_info *)arg);
+    return NULL;
+}
+
+// a pondering search ignores the time limit until the ponderhit, and
+// is then stopped by it
+void test_ponder_hit()
+{
+	struct position *pos = allocate_board();
+	consume_fen_notation(STARTING_FEN, pos);
+
+    struct search_info si;
+
+    memset(&si, 0, sizeof(struct search_info));
+
+    si.depth = MAX_SEARCH_DEPTH;
+    si.time_limits.optimum_ms = 50;
+    si.time_limits.maximum_ms = 50;
+    si.time_limits.fixed = true;
+    si.search_time_set = true;
+    si.ponder = true;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, send_ponder_hit, &si);
+
+    uint64_t start_time = get_monotonic_time_in_millis();
+    search_positions(pos, &si, 64000000);
+    uint64_t elapsed = get_elapsed_time_in_millis(start_time);
+
+    pthread_join(thread, NULL);
+
+    assert_true(si.best_move != NO_MOVE);
+    assert_true(elapsed >= 100);
+    assert_true(elapsed < 100 + 50 + 25);
+
+	free_board(pos);
+}
+
+
+void test_multi_pv()
+{
+	struct position *pos = allocate_board();
+	consume_fen_notation(STARTING_FEN, pos);
+
+    struct search_info si;
+
+    memset(&si, 0, sizeof(struct search_info));
+
+    si.depth = 5;
+    si.multi_pv = 3;
+
+    search_positions(pos, &si, 64000000);
+
+    // each line starts with a different move, the best line first
+    assert_true(si.num_lines == 3);
+    assert_true(get_move(si.best_move) == get_move(si.line_moves[0]));
+    for(uint8_t i = 0; i < 3; i++) {
+        assert_true(si.line_moves[i] != NO_MOVE);
+        for(uint8_t j = 0; j < i; j++) {
+            assert_true(get_move(si.line_moves[i]) != get_move(si.line_moves[j]));
+        }
+    }
+
+	free_board(pos);
+}
+
+
+void test_search_moves()
+{
+	struct position *pos = allocate_board();
+	consume_fen_notation(MATE_IN_TWO, pos);
+
+    struct search_info si;
+
+    memset(&si, 0, sizeof(struct search_info));
+
+    // there's a mate in two, but only a king move can be searched
+    char king_move[] = "g2f1";
+    si.search_moves[0] = parse_move(king_move, pos);
+    si.num_search_moves = 1;
+    si.depth = 4;
+    si.multi_pv = 5;
+
+    search_positions(pos, &si, 64000000);
+
+    assert_true(get_move(si.best_move) == get_move(si.search_moves[0]));
+    assert_true(si.num_lines == 1);
+
+	free_board(pos);
+}
+
+
+void test_node_limit_is_deterministic()
+{
+	struct position *pos = allocate_board();
+	consume_fen_notation(MATE_IN_TWO, pos);
+
+    struct search_info si[2];
+    const uint64_t node_limit = 50000;
+
+    for(uint8_t i = 0; i < 2; i++) {
+        memset(&si[i], 0, sizeof(struct search_info));
+        si[i].depth = MAX_SEARCH_DEPTH;
+        si[i].node_limit = node_limit;
+
+        // the result only depends on the position and the limit
+        create_tt_table(64000000);
+        clear_tt_table();
+        search_positions(pos, &si[i], 64000000);
+
+        assert_true(si[i].best_move != NO_MOVE);
+        assert_true(si[i].num_nodes <= node_limit + 1);
+    }
+
+    assert_true(si[0].num_nodes == si[1].num_nodes);
+    assert_true(si[0].best_move == si[1].best_move);
+
+	free_board(pos);
+}
+
+
+void test_mate_search()
+{
+	struct position *pos = allocate_board();
+	consume_fen_notation(MATE_IN_TWO, pos);
+
+    struct search_info si;
+    struct mate_search_result result;
+
+    memset(&si, 0, sizeof(struct search_info));
+    assert_true(search_mate(pos, &si, 2, 16000000, &result));
+    assert_true(result.mate_found);
+    assert_true(result.mate_plies == 3);
+    assert_true(result.pv_length == 3);
+
+    mv_bitmap h7h8 = get_move(MOVE(h7, h8, NO_PIECE, NO_PIECE, 0));
+    mv_bitmap h1h8 = get_move(MOVE(h1, h8, B_BISHOP, NO_PIECE, MFLAG_CAPTURE));
+    assert_true(h7h8 == get_move(result.pv_line[0]));
+    assert_true(h1h8 == get_move(result.pv_line[2]));
+
+    // the mate takes 2 moves
+    memset(&si, 0, sizeof(struct search_info));
+    assert_false(search_mate(pos, &si, 1, 16000000, &result));
+    assert_false(result.mate_found);
+
+	free_board(pos);
+}
+
+
+// the PV runs to the end of the search, and every move in it is legal
+void test_pv_is_full_length()
+{
+	struct position *pos = allocate_board();
+	consume_fen_notation(STARTING_FEN, pos);
+
+    struct search_info si;
+
+    memset(&si, 0, sizeof(struct search_info));
+    si.depth = 7;
+    search_positions(pos, &si, 64000000);
+
+    uint8_t num_moves = 0;
+    while (num_moves < MAX_SEARCH_DEPTH && get_pvline(pos, num_moves) != NO_MOVE) {
+        assert_true(make_move(pos, get_pvline(pos, num_moves)));
+        num_moves++;
+    }
+    while (get_ply(pos) > 0) {
+        take_move(pos);
+    }
+
+    assert_true(num_moves >= si.depth);
+    assert_true(get_move(get_pvline(pos, 0)) == get_move(si.best_move));
+
+	free_board(pos);
+}
+
+
+// stops a YBWC search at many different points, so the threads are
+// often leaving split points that still have moves left
+void test_ybwc_search_stops_mid_iteration()
+{
+    const char *fens[] = {
+        STARTING_FEN,
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+    };
+
+    for(uint32_t i = 0; i < 30; i++) {
+        struct position *pos = allocate_board();
+        consume_fen_notation(fens[i % 3], pos);
+
+        struct search_info si;
+        memset(&si, 0, sizeof(struct search_info));
+
+        si.depth = MAX_SEARCH_DEPTH;
+        si.num_threads = 4;
+        si.smp_mode = SMP_MODE_YBWC;
+        si.time_limits.optimum_ms = 5 + i;
+        si.time_limits.maximum_ms = 5 + i;
+        si.time_limits.fixed = true;
+        si.search_time_set = true;
+
+        search_positions(pos, &si, 16000000);
+
+        assert_true(si.best_move != NO_MOVE);
+        free_board(pos);
+    }
+}
+
+
+// after a 1 ply search, the PV continues with the recapture found by
+// the quiescence search
+void test_pv_includes_quiescence_captures()
+{
+	struct position *pos = allocate_board();
+	consume_fen_notation("r2r4/6pk/8/8/8/8/6PK/3R4 w - - 0 1", pos);
+
+    struct search_info si;
+
+    memset(&si, 0, sizeof(struct search_info));
+    si.depth = 1;
+    search_positions(pos, &si, 64000000);
+
+    mv_bitmap mv1 = get_pvline(pos, 0);
+    mv_bitmap mv2 = get_pvline(pos, 1);
+
+    assert_true(FROMSQ(mv1) == d1 && TOSQ(mv1) == d8);
+    assert_true(FROMSQ(mv2) == a8 && TOSQ(mv2) == d8);
+
+	free_board(pos);
+}
+
 
 void search_test_fixture(void)
 {
@@ -108,6 +411,16 @@ void search_test_fixture(void)
 
     run_test(test_move_sort_1);
     run_test(test_mate_in_two);
+    run_test(test_mate_in_two_extended);
+    run_test(test_search_stops_at_time_limit);
+    run_test(test_ponder_hit);
+    run_test(test_multi_pv);
+    run_test(test_search_moves);
+    run_test(test_node_limit_is_deterministic);
+    run_test(test_mate_search);
+    run_test(test_pv_is_full_length);
+    run_test(test_pv_includes_quiescence_captures);
+    run_test(test_ybwc_search_stops_mid_iteration);
 
 
     test_fixture_end();	// ends a fixture
@@ -0,0 +1,203 @@
+/*
+ * time_manager_tests.c
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "seatest.h"
+#include "time_manager.h"
+#include "time_manager_tests.h"
+
+
+void test_sudden_death_limits(void);
+void test_moves_to_go_limits(void);
+void test_move_time_limits(void);
+void test_no_time_limit(void);
+void test_scaled_optimum_time(void);
+void test_should_start_iteration(void);
+
+
+void test_sudden_death_limits(void)
+{
+    struct time_control tc = {
+        .time_left = 60000,
+        .increment = 0,
+        .moves_to_go = 0,
+        .move_time = -1
+    };
+    struct time_limits limits;
+
+    assert_true(calc_time_limits(&tc, &limits));
+    assert_false(limits.fixed);
+    assert_true(limits.optimum_ms > 0);
+    assert_true(limits.optimum_ms <= limits.maximum_ms);
+    assert_true(limits.maximum_ms <= 60000 / 2);
+
+    // the increment adds to the time
+    tc.increment = 1000;
+    struct time_limits inc_limits;
+    assert_true(calc_time_limits(&tc, &inc_limits));
+    assert_true(inc_limits.optimum_ms > limits.optimum_ms);
+}
+
+
+void test_moves_to_go_limits(void)
+{
+    struct time_control tc = {
+        .time_left = 10000,
+        .increment = 0,
+        .moves_to_go = 1,
+        .move_time = -1
+    };
+    struct time_limits limits;
+
+    // some of the clock is kept back, even on the last move before the
+    // time control
+    assert_true(calc_time_limits(&tc, &limits));
+    assert_true(limits.optimum_ms <= 10000 / 2);
+    assert_true(limits.maximum_ms <= 10000 / 2);
+
+    // very little time left still leaves some time to search
+    tc.time_left = 20;
+    tc.moves_to_go = 40;
+    assert_true(calc_time_limits(&tc, &limits));
+    assert_true(limits.maximum_ms > 0);
+    assert_true(limits.maximum_ms < 20);
+}
+
+
+void test_move_time_limits(void)
+{
+    struct time_control tc = {
+        .time_left = -1,
+        .increment = 0,
+        .moves_to_go = 0,
+        .move_time = 1000
+    };
+    struct time_limits limits;
+
+    assert_true(calc_time_limits(&tc, &limits));
+    assert_true(limits.fixed);
+    assert_true(limits.maximum_ms == 1000 - MOVE_OVERHEAD_MS);
+    assert_true(limits.optimum_ms == limits.maximum_ms);
+
+    // less than the overhead still leaves some time to search
+    tc.move_time = 40;
+    assert_true(calc_time_limits(&tc, &limits));
+    assert_true(limits.maximum_ms == 20);
+}
+
+
+void test_no_time_limit(void)
+{
+    struct time_control tc = {
+        .time_left = -1,
+        .increment = 0,
+        .moves_to_go = 0,
+        .move_time = -1
+    };
+    struct time_limits limits;
+
+    assert_false(calc_time_limits(&tc, &limits));
+}
+
+
+void test_scaled_optimum_time(void)
+{
+    struct time_limits limits = {
+        .optimum_ms = 1000,
+        .maximum_ms = 4000,
+        .fixed = false
+    };
+    struct search_progress progress;
+    memset(&progress, 0, sizeof(struct search_progress));
+
+    assert_true(get_scaled_optimum_time(&limits, &progress) == 1000);
+
+    // an unstable best move gets more time
+    progress.best_move_changes = 1.0;
+    assert_true(get_scaled_optimum_time(&limits, &progress) > 1000);
+
+    // so does a falling score
+    progress.best_move_changes = 0.0;
+    progress.score_drop = 50;
+    assert_true(get_scaled_optimum_time(&limits, &progress) > 1000);
+
+    // a clear best move gets less time
+    progress.score_drop = 0;
+    progress.best_move_node_share = 0.95;
+    assert_true(get_scaled_optimum_time(&limits, &progress) < 1000);
+
+    // never more than the maximum
+    progress.best_move_node_share = 0.0;
+    progress.best_move_changes = 10.0;
+    assert_true(get_scaled_optimum_time(&limits, &progress) == 4000);
+
+    // a fixed search time isn't scaled
+    limits.fixed = true;
+    assert_true(get_scaled_optimum_time(&limits, &progress) == 1000);
+}
+
+
+void test_should_start_iteration(void)
+{
+    struct time_limits limits = {
+        .optimum_ms = 1000,
+        .maximum_ms = 4000,
+        .fixed = false
+    };
+    struct search_progress progress;
+    memset(&progress, 0, sizeof(struct search_progress));
+
+    progress.elapsed_ms = 100;
+    progress.prev_iteration_ms = 30;
+    progress.last_iteration_ms = 60;
+    assert_true(should_start_iteration(&limits, &progress));
+
+    // past the optimum
+    progress.elapsed_ms = 1000;
+    assert_false(should_start_iteration(&limits, &progress));
+
+    // the next iteration isn't expected to finish in time
+    progress.elapsed_ms = 700;
+    progress.prev_iteration_ms = 200;
+    progress.last_iteration_ms = 500;
+    assert_false(should_start_iteration(&limits, &progress));
+
+    // a fixed search time can use all of it
+    limits.optimum_ms = 4000;
+    limits.fixed = true;
+    assert_true(should_start_iteration(&limits, &progress));
+    progress.last_iteration_ms = 2000;
+    assert_false(should_start_iteration(&limits, &progress));
+}
+
+
+void time_manager_test_fixture(void)
+{
+    test_fixture_start();	// starts a fixture
+
+    run_test(test_sudden_death_limits);
+    run_test(test_moves_to_go_limits);
+    run_test(test_move_time_limits);
+    run_test(test_no_time_limit);
+    run_test(test_scaled_optimum_time);
+    run_test(test_should_start_iteration);
+
+    test_fixture_end();	// ends a fixture
+}
@@ -0,0 +1,156 @@
+/*
+ * tt_tests.c
+ * Copyright (C) 2016 Eddie McNally <emcn@gmx.com>
+ *
+ * kestrel is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kestrel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "seatest.h"
+#include "kestrel.h"
+#include "board.h"
+#include "fen/fen.h"
+#include "move_gen.h"
+#include "move_gen_utils.h"
+#include "tt.h"
+#include "tt_tests.h"
+
+
+#define TEST_TT_SIZE	64000000
+
+
+void test_older_search_entry_is_replaced(void);
+void test_clear_tt_table_empties_entries(void);
+void test_zero_size_tt_has_one_entry(void);
+
+static void get_two_moves(mv_bitmap *mv1, mv_bitmap *mv2);
+
+
+void test_older_search_entry_is_replaced(void)
+{
+    const uint64_t hash = 0x123456789ABCDEF0ULL;
+    mv_bitmap deep_move, shallow_move;
+    get_two_moves(&deep_move, &shallow_move);
+
+    create_tt_table(TEST_TT_SIZE);
+    clear_tt_table();
+    new_tt_search();
+
+    struct tt_entry_info tte;
+    add_to_tt(hash, deep_move, 50, BOUND_EXACT, 20);
+
+    // a shallower result from the same search doesn't replace it
+    add_to_tt(hash, shallow_move, -10, BOUND_LOWER, 2);
+    assert_true(probe_tt_entry(hash, &tte));
+    assert_true(tte.move == get_move(deep_move));
+    assert_true(tte.depth == 20);
+
+    // a shallower result from a later search does
+    new_tt_search();
+    add_to_tt(hash, shallow_move, -10, BOUND_LOWER, 2);
+    assert_true(probe_tt_entry(hash, &tte));
+    assert_true(tte.move == get_move(shallow_move));
+    assert_true(tte.score == -10);
+    assert_true(tte.bound == BOUND_LOWER);
+    assert_true(tte.depth == 2);
+
+    // and is then kept, as for any entry from the current search
+    add_to_tt(hash, deep_move, 50, BOUND_EXACT, 1);
+    assert_true(probe_tt_entry(hash, &tte));
+    assert_true(tte.move == get_move(shallow_move));
+
+    clear_tt_table();
+}
+
+
+void test_clear_tt_table_empties_entries(void)
+{
+    mv_bitmap mv1, mv2;
+    get_two_moves(&mv1, &mv2);
+
+    create_tt_table(TEST_TT_SIZE);
+    clear_tt_table();
+    new_tt_search();
+
+    // spread over the table, so the cleared pages aren't all the same
+    struct tt_entry_info tte;
+    for(uint64_t i = 0; i < 1000; i++) {
+        uint64_t hash = (i + 1) * 0x9E3779B97F4A7C15ULL;
+        add_to_tt(hash, mv1, (int32_t)i, BOUND_EXACT, 5);
+        assert_true(probe_tt_entry(hash, &tte));
+    }
+
+    clear_tt_table();
+
+    for(uint64_t i = 0; i < 1000; i++) {
+        uint64_t hash = (i + 1) * 0x9E3779B97F4A7C15ULL;
+        assert_false(probe_tt_entry(hash, &tte));
+    }
+
+    dispose_tt_table();
+}
+
+
+void test_zero_size_tt_has_one_entry(void)
+{
+    mv_bitmap mv1, mv2;
+    get_two_moves(&mv1, &mv2);
+
+    // rounded up to a single entry, rather than failing to allocate
+    create_tt_table(0);
+    new_tt_search();
+
+    struct tt_entry_info tte;
+    add_to_tt(0x123456789ABCDEF0ULL, mv1, 30, BOUND_EXACT, 5);
+    assert_true(probe_tt_entry(0x123456789ABCDEF0ULL, &tte));
+    assert_true(tte.move == get_move(mv1));
+
+    // every hash maps to the same entry
+    add_to_tt(0x0FEDCBA987654321ULL, mv2, -30, BOUND_UPPER, 6);
+    assert_true(probe_tt_entry(0x0FEDCBA987654321ULL, &tte));
+    assert_false(probe_tt_entry(0x123456789ABCDEF0ULL, &tte));
+
+    dispose_tt_table();
+}
+
+
+static void get_two_moves(mv_bitmap *mv1, mv_bitmap *mv2)
+{
+    struct position *pos = allocate_board();
+    consume_fen_notation(STARTING_FEN, pos);
+
+    struct move_list mvl = {
+        .moves = {0},
+        .move_count = 0
+    };
+    generate_all_moves(pos, &mvl);
+    *mv1 = mvl.moves[0];
+    *mv2 = mvl.moves[1];
+
+    free_board(pos);
+}
+
+
+void tt_test_fixture(void)
+{
+    test_fixture_start();	// starts a fixture
+
+    run_test(test_older_search_entry_is_replaced);
+    run_test(test_clear_tt_table_empties_entries);
+    run_test(test_zero_size_tt_has_one_entry);
+
+    test_fixture_end();	// ends a fixture
+}